@@ -0,0 +1,193 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "direct-queue.h"
+
+//------------------------------ DirectQueue ADT IMPLEMENTATIONS ----------------------------
+
+/*
+    Returns 0 if enqueue failed (allocation failure or ID already queued), 1 if succeeded.
+    The queue never moves, so the returned queue is always the one passed in.
+*/
+static QueueResultPair DirectQueue_enqueue(Thread *t, ThreadQueue *queue) {
+    DirectQueue *directqueue = (DirectQueue*) queue;
+    QueueResultPair result = {queue, 0};
+
+    if (directqueue -> index[t -> id] != NULL) {
+        return result;
+    }
+
+    Entry *new_entry = EntryPool_alloc(&(directqueue -> pool));
+    if (new_entry == NULL) {
+        printf("Entry memory allocation failed.\n");
+        return result;
+    }
+
+    new_entry -> prev = directqueue -> tail;
+    new_entry -> next = NULL;
+    new_entry -> t = t;
+    new_entry -> table_index = t -> id;
+
+    if (directqueue -> tail == NULL) {
+        directqueue -> head = new_entry;
+    } else {
+        directqueue -> tail -> next = new_entry;
+    }
+    directqueue -> tail = new_entry;
+
+    directqueue -> index[t -> id] = new_entry;
+    ++ directqueue -> _size;
+
+    result.result = 1;
+    return result;
+}
+
+/*
+    - Unlinks an Entry from the FIFO and the index, returning its Thread
+*/
+static Thread *DirectQueue_unlink(Entry *entry, DirectQueue *directqueue) {
+    Entry *prev = entry -> prev;
+    Entry *next = entry -> next;
+
+    if (prev == NULL) {
+        directqueue -> head = next;
+    } else {
+        prev -> next = next;
+    }
+
+    if (next == NULL) {
+        directqueue -> tail = prev;
+    } else {
+        next -> prev = prev;
+    }
+
+    directqueue -> index[entry -> table_index] = NULL;
+    -- directqueue -> _size;
+
+    Thread *t = entry -> t;
+    EntryPool_release(entry, &(directqueue -> pool));
+    return t;
+}
+
+static Thread *DirectQueue_dequeue(ThreadQueue *queue) {
+    DirectQueue *directqueue = (DirectQueue*) queue;
+
+    if (directqueue -> head == NULL) {
+        return NULL;
+    }
+
+    return DirectQueue_unlink(directqueue -> head, directqueue);
+}
+
+static Thread *DirectQueue_removeByID(u16 thread_id, ThreadQueue *queue) {
+    DirectQueue *directqueue = (DirectQueue*) queue;
+    Entry *entry = directqueue -> index[thread_id];
+
+    if (entry == NULL) {
+        return NULL;
+    }
+
+    return DirectQueue_unlink(entry, directqueue);
+}
+
+static Thread *DirectQueue_getByID(u16 thread_id, ThreadQueue *queue) {
+    DirectQueue *directqueue = (DirectQueue*) queue;
+    Entry *entry = directqueue -> index[thread_id];
+    return (entry == NULL) ? NULL : entry -> t;
+}
+
+static int DirectQueue_contains(u16 thread_id, ThreadQueue *queue) {
+    DirectQueue *directqueue = (DirectQueue*) queue;
+    return (directqueue -> index[thread_id] != NULL);
+}
+
+static int DirectQueue_isEmpty(ThreadQueue *queue) {
+    DirectQueue *directqueue = (DirectQueue*) queue;
+    return (directqueue -> _size == 0);
+}
+
+static int DirectQueue_size(ThreadQueue *queue) {
+    DirectQueue *directqueue = (DirectQueue*) queue;
+    return directqueue -> _size;
+}
+
+//----------------------------------- ITERATOR FUNCTIONS  -----------------------------------------
+
+static Thread *DirectIterator_next(Iterator *iterator) {
+    Entry *curr = iterator -> currentEntry;
+    iterator -> currentEntry = curr -> next;
+    return curr -> t;
+}
+
+static int DirectIterator_hasNext(Iterator *iterator) {
+    return iterator -> currentEntry != NULL;
+}
+
+static Iterator *new_DirectIterator(ThreadQueue *queue) {
+    DirectQueue *directqueue = (DirectQueue*) queue;
+    Iterator *iterator = malloc(sizeof(Iterator));
+    if (iterator == NULL) {
+        return NULL;
+    }
+
+    iterator -> hasNext = DirectIterator_hasNext;
+    iterator -> next = DirectIterator_next;
+    iterator -> currentEntry = directqueue -> head;
+    iterator -> queue = queue;
+    iterator -> remaining = 0;
+
+    return iterator;
+}
+
+//----------------------------------- CONSTRUCTORS + DESTRUCTOR -----------------------------------
+
+static void DirectQueue_free(ThreadQueue *queue) {
+    DirectQueue *directqueue = (DirectQueue*) queue;
+    EntryPool_free(&(directqueue -> pool));
+    free(directqueue -> index);
+    free(directqueue);
+}
+
+/*
+    Returns 0 if any malloc failed, 1 otherwise.
+*/
+int init_DirectQueue(DirectQueue *this) {
+    this -> _size = 0;
+    this -> head = NULL;
+    this -> tail = NULL;
+    this -> index = calloc(MAX_THREADS, sizeof(Entry*));
+    if (this -> index == NULL) {
+        return 0;
+    }
+
+    if (init_EntryPool(&(this -> pool)) == 0) {
+        free(this -> index);
+        return 0;
+    }
+
+    this -> dequeue = DirectQueue_dequeue;
+    this -> contains = DirectQueue_contains;
+    this -> enqueue = DirectQueue_enqueue;
+    this -> isEmpty = DirectQueue_isEmpty;
+    this -> removeByID = DirectQueue_removeByID;
+    this -> getByID = DirectQueue_getByID;
+    this -> iterator = new_DirectIterator;
+    this -> size = DirectQueue_size;
+    this -> freeQueue = DirectQueue_free;
+    this -> enqueueBatch = ThreadQueue_enqueueEach;
+    this -> dequeueN = ThreadQueue_dequeueEach;
+
+    return 1;
+}
+
+DirectQueue *new_DirectQueue() {
+    DirectQueue *this = malloc(sizeof(DirectQueue));
+    if (this == NULL) {
+        return NULL;
+    }
+    if (init_DirectQueue(this) == 0) {
+        free(this);
+        return NULL;
+    }
+    return this;
+}
@@ -0,0 +1,41 @@
+#ifndef DIRECT_QUEUE_H
+#define DIRECT_QUEUE_H
+
+#include "hash-queue.h"
+
+typedef struct DirectQueue DirectQueue;
+
+/*
+    HashQueue backend specialised for u16 thread IDs:
+    - the table is a flat MAX_THREADS index keyed directly by ID, so lookups are a single load
+    - no hashing, probing, table repair or rehashing ever takes place
+    - Entries are drawn from the same EntryPool as the HashQueue
+
+    As each ID owns exactly one slot, duplicate IDs are rejected by enqueue.
+*/
+struct DirectQueue {
+    // Common Queue Interface
+    Thread* (*dequeue) (ThreadQueue*);                     // Input: queue. Output: dequeued element
+    int (*contains) (u16, ThreadQueue*);                   // success/failure return value
+    QueueResultPair (*enqueue) (Thread*, ThreadQueue*);    // Inputs: enqueue element, queue. Output: queue pointer, enqueue success/failure
+    int (*isEmpty) (ThreadQueue*);                         // success/failure return value
+    Thread* (*removeByID) (u16, ThreadQueue*);             // Inputs: ID, queue. Output: removed element
+    Thread* (*getByID) (u16, ThreadQueue*);                // Returns a reference to the Thread, but does not remove
+    Iterator* (*iterator)(ThreadQueue*);
+    int (*size) (ThreadQueue*);                            // Returns the number of elements in the DirectQueue
+    void (*freeQueue) (ThreadQueue*);
+    QueueResultPair (*enqueueBatch) (Thread**, int, ThreadQueue*);  // Inputs: elements, count, queue. Output: queue pointer, number enqueued
+    int (*dequeueN) (Thread**, int, ThreadQueue*);                  // Inputs: output array, max count, queue. Output: number dequeued, oldest first
+
+    // Direct Queue only
+    int _size;
+    Entry *head;
+    Entry *tail;
+    Entry **index;                                         // MAX_THREADS slots, index[id] is the Entry for id or NULL
+    EntryPool pool;
+};
+
+DirectQueue *new_DirectQueue();
+int init_DirectQueue(DirectQueue*);
+
+#endif /* DIRECT_QUEUE_H */
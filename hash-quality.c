@@ -0,0 +1,146 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "hash-queue.h"
+
+#define QUALITY_MIN_CAPACITY INITIAL_CAPACITY
+#define QUALITY_MAX_CAPACITY 131072
+#define QUALITY_STRIDE 16                   // IDs handed out round robin from 16 per-CPU ranges
+
+/*
+    Hash quality report
+    - fills a table to REHASH_THRESHOLD at each capacity, the fullest a HashQueue gets before growing
+    - bucket distribution: share of ideal slots used by at least one ID, and the most IDs sharing one
+      (a uniform hash at load 0.5 uses about 39% of slots)
+    - probe lengths are measured by Robin Hood insertion, as HashQueue places Entries
+*/
+
+typedef struct HashFunction HashFunction;
+typedef struct IDPattern IDPattern;
+
+struct HashFunction {
+    const char *name;
+    u32 (*hash) (u16);
+};
+
+struct IDPattern {
+    const char *name;
+    u16 (*id) (int);
+};
+
+static u16 sequentialID(int i) {
+    return (u16) i;
+}
+
+/*
+    - Rotates i so consecutive IDs are QUALITY_STRIDE apart, and every u16 is still produced once
+*/
+static u16 stridedID(int i) {
+    const int ranges = MAX_THREADS / QUALITY_STRIDE;
+    return (u16) ((i % ranges) * QUALITY_STRIDE + i / ranges);
+}
+
+static const HashFunction hash_functions[] = {
+    {"IDHash", IDHash},
+    {"FNV1AHash", FNV1AHash},
+    {"FibonacciHash", FibonacciHash},
+    {"MurmurHash", MurmurHash},
+    {"XorShiftHash", XorShiftHash},
+};
+
+static const IDPattern id_patterns[] = {
+    {"sequential", sequentialID},
+    {"strided", stridedID},
+};
+
+/*
+    - Robin Hood insertion of id, as HashQueue_place does
+*/
+static void place(u16 id, u32 (*hash) (u16), Slot *slots, int capacity) {
+    const u32 table_mask = capacity - 1;
+    u32 table_index = hash(id) & table_mask;
+    Slot carried = {id, 0};
+
+    while (slots[table_index].probe_distance != SLOT_EMPTY) {
+        if (slots[table_index].probe_distance < carried.probe_distance) {
+            Slot displaced = slots[table_index];
+            slots[table_index] = carried;
+            carried = displaced;
+        }
+        table_index = (table_index + 1) & table_mask;
+        ++ carried.probe_distance;
+    }
+    slots[table_index] = carried;
+}
+
+static void report(const HashFunction *function, const IDPattern *pattern, int capacity, Slot *slots, int *buckets) {
+    int count = (int) (capacity * REHASH_THRESHOLD);
+    if (count > MAX_THREADS) {
+        count = MAX_THREADS;
+    }
+
+    for (int i = 0; i < capacity; ++i) {
+        slots[i].probe_distance = SLOT_EMPTY;
+        buckets[i] = 0;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        const u16 id = pattern -> id(i);
+        ++ buckets[function -> hash(id) & (capacity - 1)];
+        place(id, function -> hash, slots, capacity);
+    }
+
+    int used = 0;
+    int max_bucket = 0;
+    for (int i = 0; i < capacity; ++i) {
+        used += (buckets[i] > 0);
+        if (buckets[i] > max_bucket) {
+            max_bucket = buckets[i];
+        }
+    }
+
+    // a lookup compares probe_distance + 1 slots
+    long total_probes = 0;
+    int max_probe = 0;
+    for (int i = 0; i < capacity; ++i) {
+        if (slots[i].probe_distance != SLOT_EMPTY) {
+            total_probes += slots[i].probe_distance + 1;
+            if (slots[i].probe_distance + 1 > max_probe) {
+                max_probe = slots[i].probe_distance + 1;
+            }
+        }
+    }
+
+    printf("%-14s %-10s %8d %8d %9.1f%% %10d %10.2f %10d\n",
+        function -> name, pattern -> name, capacity, count,
+        100.0 * used / capacity, max_bucket, (double) total_probes / count, max_probe);
+}
+
+int main(void) {
+    Slot *slots = malloc(QUALITY_MAX_CAPACITY * sizeof(Slot));
+    int *buckets = malloc(QUALITY_MAX_CAPACITY * sizeof(int));
+    if (slots == NULL || buckets == NULL) {
+        printf("malloc failed");
+        free(slots);
+        free(buckets);
+        return 1;
+    }
+
+    printf("%-14s %-10s %8s %8s %10s %10s %10s %10s\n",
+        "hash", "ids", "capacity", "count", "used", "max bucket", "avg probe", "max probe");
+
+    const int function_count = sizeof(hash_functions) / sizeof(hash_functions[0]);
+    const int pattern_count = sizeof(id_patterns) / sizeof(id_patterns[0]);
+    for (int p = 0; p < pattern_count; ++p) {
+        for (int f = 0; f < function_count; ++f) {
+            for (int capacity = QUALITY_MIN_CAPACITY; capacity <= QUALITY_MAX_CAPACITY; capacity <<= 1) {
+                report(&hash_functions[f], &id_patterns[p], capacity, slots, buckets);
+            }
+            printf("\n");
+        }
+    }
+
+    free(slots);
+    free(buckets);
+    return 0;
+}
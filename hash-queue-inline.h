@@ -0,0 +1,158 @@
+#ifndef HASH_QUEUE_INLINE_H
+#define HASH_QUEUE_INLINE_H
+
+#include <assert.h>
+
+#include "hash-queue.h"
+
+/*
+    Header-inline HashQueue API, for hot paths that know they hold a HashQueue
+    - hq_* calls are direct, the vtable in HashQueue is left for polymorphic ThreadQueue users
+    - lookups are inlined completely, hashing with HQ_HASH instead of through getHash
+    - enqueue/dequeue/removeByID call straight into hash-queue.c
+
+    HQ_HASH selects the hash at compile time, and HQ_HASH_FN names the matching exported function
+    that hq_new installs as getHash. Define both before including this header to change them.
+    hq_* lookups require getHash == HQ_HASH_FN, which hq_new guarantees and which is asserted
+    for queues built any other way.
+    Building hash-queue.c with HQ_STATIC_HASH makes the library hash with HQ_HASH too,
+    in which case assigning getHash at runtime has no effect, and the assertion is dropped.
+*/
+
+//------------------------------ Hash Functions ---------------------------------------------
+
+static inline u32 hq_idHash(u16 data) {
+    return data;
+}
+
+static inline u32 hq_fnv1aHash(u16 data) {
+    u32 hash = FNV_32_OFFSET_BASIS;
+    hash ^= (FIRST_OCTET_MASK) & data;      // XOR with first octet
+    hash *= FNV_32_PRIME;                   // Multiply by FNV32 Prime
+
+    hash ^= ((SECOND_OCTET_MASK) & data) >> 8;  // XOR with second octet
+    hash *= FNV_32_PRIME;                   // Multiply by FNV32 prime
+
+    return hash;
+}
+
+/*
+    - Multiplies by 2^32 / phi, then rotates the well mixed top half into the low bits,
+      since & table_mask keeps the low bits and those only repeat the low bits of the ID
+*/
+static inline u32 hq_fibonacciHash(u16 data) {
+    const u32 hash = (u32) data * FIBONACCI_32_MULTIPLIER;
+    return (hash >> 16) | (hash << 16);
+}
+
+/*
+    - MurmurHash3 finalizer (fmix32), every input bit affects every output bit
+*/
+static inline u32 hq_murmurHash(u16 data) {
+    u32 hash = data;
+    hash ^= hash >> 16;
+    hash *= MURMUR_FMIX_C1;
+    hash ^= hash >> 13;
+    hash *= MURMUR_FMIX_C2;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+/*
+    - xorshift32 step, no multiplies. Low bits end up as id ^ (id << 5),
+      so sequential IDs still cover a masked table evenly
+*/
+static inline u32 hq_xorShiftHash(u16 data) {
+    u32 hash = data;
+    hash ^= hash << 13;
+    hash ^= hash >> 17;
+    hash ^= hash << 5;
+    return hash;
+}
+
+#ifndef HQ_HASH
+#define HQ_HASH hq_fnv1aHash
+#ifndef HQ_HASH_FN
+#define HQ_HASH_FN FNV1AHash
+#endif
+#endif
+
+#ifndef HQ_HASH_FN
+#error "HQ_HASH is defined without HQ_HASH_FN, define HQ_HASH_FN as the exported hash function matching HQ_HASH"
+#endif
+
+//------------------------------ Inline Operations ------------------------------------------
+
+static inline int hq_isEmpty(const HashQueue *hq) {
+    return hq -> _size == 0;
+}
+
+static inline int hq_size(const HashQueue *hq) {
+    return hq -> _size;
+}
+
+/*
+    - Probes one table for thread_id, as HashQueue_findSlot does
+*/
+static inline Entry *hq_probe(u16 thread_id, Entry **table, const Slot *slots, int capacity) {
+    const u32 table_mask = capacity - 1;
+    u32 table_index = HQ_HASH(thread_id) & table_mask;
+    u16 probe_distance = 0;
+
+    while (slots[table_index].probe_distance != SLOT_EMPTY && slots[table_index].probe_distance >= probe_distance) {
+        if (slots[table_index].id == thread_id) {
+            return table[table_index];
+        }
+        table_index = (table_index + 1) & table_mask;
+        ++ probe_distance;
+    }
+    return NULL;
+}
+
+static inline Entry *hq_findEntry(const HashQueue *hq, u16 thread_id) {
+#ifndef HQ_STATIC_HASH
+    assert(hq -> getHash == HQ_HASH_FN);                  // the table was built with getHash, the probe uses HQ_HASH
+#endif
+    Entry *entry = hq_probe(thread_id, hq -> table, hq -> slots, hq -> capacity);
+    if (entry == NULL && hq -> old_table != NULL) {
+        entry = hq_probe(thread_id, hq -> old_table, hq -> old_slots, hq -> old_capacity);
+    }
+    return entry;
+}
+
+static inline Thread *hq_getByID(const HashQueue *hq, u16 thread_id) {
+    Entry *entry = hq_findEntry(hq, thread_id);
+    return (entry == NULL) ? NULL : entry -> t;
+}
+
+static inline int hq_contains(const HashQueue *hq, u16 thread_id) {
+    return hq_findEntry(hq, thread_id) != NULL;
+}
+
+/*
+    Returns 0 if enqueue failed, 1 if succeeded.
+*/
+static inline int hq_enqueue(HashQueue *hq, Thread *t) {
+    return HashQueue_enqueue(t, (ThreadQueue*) hq).result;
+}
+
+static inline Thread *hq_dequeue(HashQueue *hq) {
+    return HashQueue_dequeue((ThreadQueue*) hq);
+}
+
+static inline Thread *hq_removeByID(HashQueue *hq, u16 thread_id) {
+    return HashQueue_removeByID(thread_id, (ThreadQueue*) hq);
+}
+
+/*
+    - new_HashQueue, hashing with HQ_HASH_FN so hq_* lookups agree with the table
+*/
+static inline HashQueue *hq_new(void) {
+    HashQueue *hq = new_HashQueue();
+    if (hq != NULL) {
+        hq -> getHash = HQ_HASH_FN;
+    }
+    return hq;
+}
+
+#endif /* HASH_QUEUE_INLINE_H */
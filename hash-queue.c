@@ -1,58 +1,771 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #include "hash-queue.h"
+#include "hash-queue-inline.h"
 
 //------------------------------ Hash Functions ---------------------------------------------
 
+// Bodies live in hash-queue-inline.h so hq_* lookups can inline them
+
 u32 IDHash(u16 data) {
-    return data;
+    return hq_idHash(data);
 }
 
 u32 FNV1AHash(u16 data) {
-    u32 hash = FNV_32_OFFSET_BASIS;
-    hash ^= (FIRST_OCTET_MASK) & data;      // XOR with first octet
-    hash *= FNV_32_PRIME;                   // Multiply by FNV32 Prime
+    return hq_fnv1aHash(data);
+}
 
-    hash ^= (SECOND_OCTET_MASK) & data;     // XOR with second octet
-    hash *= FNV_32_PRIME;                   // Multiply by FNV32 prime
+u32 FibonacciHash(u16 data) {
+    return hq_fibonacciHash(data);
+}
 
-    return hash;
-    //return (hash >> 16) ^ (hash & 0xffff); // XOR Fold the hash before returning
+u32 MurmurHash(u16 data) {
+    return hq_murmurHash(data);
 }
 
-//------------------------------ HashQueue ADT IMPLEMENTATIONS ------------------------------
+u32 XorShiftHash(u16 data) {
+    return hq_xorShiftHash(data);
+}
 
 /*
-    Returns -1 if enqueue failed, 1 if succeeded, 2 if succeeded but rehashing required.
+    - HQ_STATIC_HASH builds hash with HQ_HASH directly, getHash is then ignored
 */
-static QueueResultPair HashQueue_enqueue(Thread *t, ThreadQueue *queue) {
+static inline u32 HashQueue_hash(u16 thread_id, const HashQueue *hashqueue) {
+#ifdef HQ_STATIC_HASH
+    (void) hashqueue;
+    return HQ_HASH(thread_id);
+#else
+    return hashqueue -> getHash(thread_id);
+#endif
+}
 
-    HashQueue *hashqueue = (HashQueue*) queue;
-    const u16 thread_id = t -> id;
-    const u32 table_mask = (hashqueue -> capacity) - 1;
-    u32 table_index = hashqueue -> getHash(thread_id) & table_mask;
+//------------------------------ Entry Pool -----------------------------------------------
+
+/*
+    - Allocates a single slab and threads all of its Entries onto the free list
+    Returns 0 if the slab allocation failed, 1 otherwise.
+*/
+static int EntryPool_grow(EntryPool *pool) {
+    EntrySlab *slab = malloc(sizeof(EntrySlab));
+    if (slab == NULL) {
+        return 0;
+    }
+
+    slab -> next = pool -> slabs;
+    pool -> slabs = slab;
+
+    for (int i = 0; i < ENTRY_SLAB_SIZE; ++i) {
+        slab -> entries[i].next = pool -> free_list;
+        pool -> free_list = &(slab -> entries[i]);
+    }
+
+    return 1;
+}
+
+/*
+    - Pre-allocates the first slab so the first enqueues do not hit the heap
+    Returns 0 if the slab allocation failed, 1 otherwise.
+*/
+int init_EntryPool(EntryPool *pool) {
+    pool -> slabs = NULL;
+    pool -> free_list = NULL;
+    return EntryPool_grow(pool);
+}
+
+/*
+    - Pops an Entry off the free list, only growing the pool once it runs dry
+    Returns NULL if a new slab was required and could not be allocated.
+*/
+Entry *EntryPool_alloc(EntryPool *pool) {
+    if (pool -> free_list == NULL && EntryPool_grow(pool) == 0) {
+        return NULL;
+    }
+
+    Entry *entry = pool -> free_list;
+    pool -> free_list = entry -> next;
+    return entry;
+}
+
+void EntryPool_release(Entry *entry, EntryPool *pool) {
+    entry -> next = pool -> free_list;
+    pool -> free_list = entry;
+}
+
+/*
+    - Frees every slab, and therefore every Entry, in one pass
+*/
+void EntryPool_free(EntryPool *pool) {
+    EntrySlab *slab = pool -> slabs;
+    while (slab != NULL) {
+        EntrySlab *next = slab -> next;
+        free(slab);
+        slab = next;
+    }
+    pool -> slabs = NULL;
+    pool -> free_list = NULL;
+}
+
+//------------------------------ Statistics -------------------------------------------------
+
+/*
+    - Recording compiles away unless HASHQUEUE_STATS is defined, arguments are still evaluated
+      so repair functions run either way
+*/
+#ifdef HASHQUEUE_STATS
+#define STATS_ADD(hashqueue, field, n) ((hashqueue) -> stats.field += (n))
+#define STATS_PROBE(hashqueue, kind, probes) ProbeStats_record(&((hashqueue) -> stats.kind), (probes))
+
+static void ProbeStats_record(ProbeStats *stats, u32 probes) {
+    ++ stats -> count;
+    stats -> total += probes;
+    if (probes > stats -> max) {
+        stats -> max = probes;
+    }
+    ++ stats -> histogram[(probes < STATS_PROBE_BUCKETS) ? probes - 1 : STATS_PROBE_BUCKETS - 1];
+}
+
+#define STATS_CLOCK() clock()
+#define STATS_RESIZE(hashqueue, grew, begin) HashQueueStats_resize(&((hashqueue) -> stats), (grew), (begin))
+
+static void HashQueueStats_resize(HashQueueStats *stats, int grew, clock_t begin) {
+    const double elapsed_ms = (double) (clock() - begin) * 1000 / CLOCKS_PER_SEC;
+    if (grew) {
+        ++ stats -> rehashes;
+    } else {
+        ++ stats -> shrinks;
+    }
+    stats -> rehash_ms += elapsed_ms;
+    if (elapsed_ms > stats -> max_rehash_ms) {
+        stats -> max_rehash_ms = elapsed_ms;
+    }
+}
+#else
+#define STATS_ADD(hashqueue, field, n) ((void) (n))
+#define STATS_PROBE(hashqueue, kind, probes) ((void) (probes))
+#define STATS_CLOCK() ((clock_t) 0)
+#define STATS_RESIZE(hashqueue, grew, begin) ((void) (grew), (void) (begin))
+#endif
+
+/*
+    - Returns a copy, so callers can diff snapshots taken around a workload
+*/
+HashQueueStats HashQueue_getStats(HashQueue *hashqueue) {
+    HashQueueStats stats;
+#ifdef HASHQUEUE_STATS
+    stats = hashqueue -> stats;
+#else
+    (void) hashqueue;
+    memset(&stats, 0, sizeof(stats));
+#endif
+    return stats;
+}
+
+void HashQueue_resetStats(HashQueue *hashqueue) {
+#ifdef HASHQUEUE_STATS
+    memset(&(hashqueue -> stats), 0, sizeof(hashqueue -> stats));
+#else
+    (void) hashqueue;
+#endif
+}
+
+static void ProbeStats_dump(const char *name, const ProbeStats *stats) {
+    printf("%s: %llu probes, avg %.2f, max %u\n", name, stats -> count,
+        (stats -> count == 0) ? 0.0 : (double) stats -> total / stats -> count, stats -> max);
+
+    for (int i = 0; i < STATS_PROBE_BUCKETS; ++i) {
+        if (stats -> histogram[i] == 0) {
+            continue;
+        }
+        const double share = 100.0 * stats -> histogram[i] / stats -> count;
+        printf("  %2d%s slots: %10llu  %5.1f%%\n", i + 1, (i == STATS_PROBE_BUCKETS - 1) ? "+" : " ",
+            stats -> histogram[i], share);
+    }
+}
+
+/*
+    - Prints the counters and both probe length histograms
+*/
+void HashQueue_dumpStats(HashQueue *hashqueue) {
+    const HashQueueStats stats = HashQueue_getStats(hashqueue);
+
+#ifndef HASHQUEUE_STATS
+    printf("HashQueue built without HASHQUEUE_STATS, nothing recorded\n");
+#endif
+    printf("size %d, capacity %d\n", hashqueue -> _size, hashqueue -> capacity);
+    printf("rehashes: %llu, shrinks: %llu, grow failures: %llu, resize time %.3f ms (max %.3f ms)\n",
+        stats.rehashes, stats.shrinks, stats.grow_failures, stats.rehash_ms, stats.max_rehash_ms);
+    printf("repair moves: %llu\n", stats.repair_moves);
+    ProbeStats_dump("insert", &(stats.insert));
+    ProbeStats_dump("lookup", &(stats.lookup));
+}
+
+//------------------------------ Optimistic Readers ------------------------------------------
 
-    while (hashqueue -> table[table_index] != NULL) // iterate while positions unavailable
+/*
+    Anything an optimistic reader probes (the table pointers and capacities, slots, table cells and Entry.t)
+    is written by the owner and read by readers with relaxed atomics, so neither side sees a torn value.
+    The seqlock supplies the ordering, the owner's own reads stay plain.
+*/
+#define SHARED_LOAD(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+#define SHARED_STORE(field, value) __atomic_store_n(&(field), (value), __ATOMIC_RELAXED)
+
+/*
+    Seqlock write side, owning CPU only
+        - seq is odd while the table is being modified, and bumped again once it is consistent
+        - sections nest (enqueue may rehash), only the outermost one touches seq
+        - tables replaced by rehash, shrink or migration are retired rather than freed,
+          and reclaimed at the end of a write section once no reader is inside the queue
+*/
+static void HashQueue_reclaim(HashQueue *hashqueue);
+
+static void HashQueue_writeBegin(HashQueue *hashqueue) {
+    if (hashqueue -> write_depth ++ == 0) {
+        atomic_store_explicit(&(hashqueue -> seq), atomic_load_explicit(&(hashqueue -> seq), memory_order_relaxed) + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+    }
+}
+
+static void HashQueue_writeEnd(HashQueue *hashqueue) {
+    if (-- hashqueue -> write_depth == 0) {
+        atomic_store_explicit(&(hashqueue -> seq), atomic_load_explicit(&(hashqueue -> seq), memory_order_relaxed) + 1, memory_order_release);
+        if (hashqueue -> retired != NULL) {
+            HashQueue_reclaim(hashqueue);
+        }
+    }
+}
+
+/*
+    - Queues a replaced table for freeing
+    - If the retired node can't be allocated, waits for readers to leave and frees straight away
+*/
+static void HashQueue_retireTable(Entry **table, Slot *slots, HashQueue *hashqueue) {
+    RetiredTable *retired = malloc(sizeof(RetiredTable));
+    if (retired == NULL) {
+        atomic_thread_fence(memory_order_seq_cst);
+        while (atomic_load(&(hashqueue -> readers)) != 0) {
+            // readers only hold the queue for a single probe
+        }
+        free(table);
+        free(slots);
+        return;
+    }
+
+    retired -> table = table;
+    retired -> slots = slots;
+    retired -> next = hashqueue -> retired;
+    hashqueue -> retired = retired;
+}
+
+static void HashQueue_freeRetired(RetiredTable *retired) {
+    while (retired != NULL) {
+        RetiredTable *next = retired -> next;
+        free(retired -> table);
+        free(retired -> slots);
+        free(retired);
+        retired = next;
+    }
+}
+
+/*
+    - Frees every retired table if no reader is inside the queue, otherwise tries again after the next write
+    A reader arriving after the check loads the current table pointers, never a retired one.
+*/
+static void HashQueue_reclaim(HashQueue *hashqueue) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&(hashqueue -> readers), memory_order_acquire) == 0) {
+        HashQueue_freeRetired(hashqueue -> retired);
+        hashqueue -> retired = NULL;
+    }
+}
+
+/*
+    - Probes one table snapshot for thread_id, bounded by capacity as the table may change underneath
+*/
+static Entry *HashQueue_readProbe(u16 thread_id, Entry **table, Slot *slots, int capacity, HashQueue *hashqueue) {
+    const u32 table_mask = capacity - 1;
+    u32 table_index = HashQueue_hash(thread_id, hashqueue) & table_mask;
+
+    for (int probe_distance = 0; probe_distance < capacity; ++probe_distance) {
+        const u16 slot_distance = SHARED_LOAD(slots[table_index].probe_distance);
+        if (slot_distance == SLOT_EMPTY || slot_distance < probe_distance) {
+            return NULL;
+        }
+        if (SHARED_LOAD(slots[table_index].id) == thread_id) {
+            return SHARED_LOAD(table[table_index]);
+        }
+        table_index = (table_index + 1) & table_mask;
+    }
+    return NULL;
+}
+
+/*
+    Optimistic lookup, callable from any CPU while the owner keeps modifying the queue
+        - Announce the reader, so no table it might still be probing is freed
+        - Take a snapshot of the table pointers, valid if seq was even and unchanged throughout
+        - Probe the snapshot, and retry if seq moved while probing
+    Never blocks the owning CPU. The returned Thread was queued at some point during the call.
+*/
+static Thread *HashQueue_readLookup(u16 thread_id, HashQueue *hashqueue) {
+    Thread *t = NULL;
+    u32 start;
+
+    atomic_fetch_add(&(hashqueue -> readers), 1);
+    atomic_thread_fence(memory_order_seq_cst);                  // pairs with the fence in HashQueue_reclaim
+    do {
+        start = atomic_load_explicit(&(hashqueue -> seq), memory_order_acquire);
+        if (start & 1) {
+            continue;
+        }
+
+        Entry **table = SHARED_LOAD(hashqueue -> table);
+        Slot *slots = SHARED_LOAD(hashqueue -> slots);
+        const int capacity = SHARED_LOAD(hashqueue -> capacity);
+        Entry **old_table = SHARED_LOAD(hashqueue -> old_table);
+        Slot *old_slots = SHARED_LOAD(hashqueue -> old_slots);
+        const int old_capacity = SHARED_LOAD(hashqueue -> old_capacity);
+
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&(hashqueue -> seq), memory_order_relaxed) != start) {
+            continue;                                           // snapshot is torn
+        }
+
+        Entry *entry = HashQueue_readProbe(thread_id, table, slots, capacity, hashqueue);
+        if (entry == NULL && old_table != NULL) {
+            entry = HashQueue_readProbe(thread_id, old_table, old_slots, old_capacity, hashqueue);
+        }
+        t = (entry == NULL) ? NULL : SHARED_LOAD(entry -> t);   // Entries are pooled, so always readable
+
+        atomic_thread_fence(memory_order_acquire);
+    } while ((start & 1) || atomic_load_explicit(&(hashqueue -> seq), memory_order_relaxed) != start);
+    atomic_fetch_sub(&(hashqueue -> readers), 1);
+
+    return t;
+}
+
+Thread *HashQueue_readGetByID(u16 thread_id, HashQueue *hashqueue) {
+    return HashQueue_readLookup(thread_id, hashqueue);
+}
+
+int HashQueue_readContains(u16 thread_id, HashQueue *hashqueue) {
+    return HashQueue_readLookup(thread_id, hashqueue) != NULL;
+}
+
+//------------------------------ HashQueue ADT IMPLEMENTATIONS ------------------------------
+
+/*
+    Robin Hood insertion
+        - Linear probe from the Entry's ideal slot, counting the probe distance
+        - If the occupant sits closer to its own ideal slot than we do to ours,
+          the carried Entry takes the slot and the occupant is carried on instead
+        - Place the carried Entry in the first empty slot
+    Keeps every probe sequence short, and sorted by probe distance, so lookups can stop early.
+    Probing only reads the dense slots array, table is written once per placement.
+*/
+static void HashQueue_place(Entry *entry, Entry **table, Slot *slots, int capacity, HashQueue *hashqueue) {
+    const u32 table_mask = capacity - 1;
+    u16 thread_id = entry -> t -> id;
+    u32 table_index = HashQueue_hash(thread_id, hashqueue) & table_mask;
+    const u32 start_index = table_index;
+    u16 probe_distance = 0;
+
+    while (slots[table_index].probe_distance != SLOT_EMPTY) // iterate while positions unavailable
     {
+        if (slots[table_index].probe_distance < probe_distance) {
+            Entry *occupant = table[table_index];
+            const Slot displaced = slots[table_index];
+
+            SHARED_STORE(table[table_index], entry);
+            SHARED_STORE(slots[table_index].id, thread_id);
+            SHARED_STORE(slots[table_index].probe_distance, probe_distance);
+            entry -> table_index = table_index;
+
+            entry = occupant;                                   // continue by placing the displaced occupant
+            thread_id = displaced.id;
+            probe_distance = displaced.probe_distance;
+        }
         table_index = (table_index + 1) & table_mask;
+        ++ probe_distance;
     }
 
+    SHARED_STORE(table[table_index], entry);
+    SHARED_STORE(slots[table_index].id, thread_id);
+    SHARED_STORE(slots[table_index].probe_distance, probe_distance);
+    entry -> table_index = table_index;
+    STATS_PROBE(hashqueue, insert, ((table_index - start_index) & table_mask) + 1);
+}
+
+/*
+    - Probes slots for thread_id, returning its index or -1 if not found
+    - Gives up as soon as an occupant is closer to its ideal slot than we are to ours,
+      as Robin Hood insertion would have placed thread_id before it
+    - IDs are compared inline, no Entry or Thread is touched
+*/
+static int HashQueue_findSlot(u16 thread_id, Slot *slots, int capacity, HashQueue *hashqueue) {
+    const u32 table_mask = capacity - 1;
+    u32 table_index = HashQueue_hash(thread_id, hashqueue) & table_mask;
+    u16 probe_distance = 0;
+
+    // SLOT_EMPTY is the largest distance, so empty slots end the search via the id check
+    while (slots[table_index].probe_distance >= probe_distance)
+    {
+        if (slots[table_index].id == thread_id && slots[table_index].probe_distance != SLOT_EMPTY) {
+            STATS_PROBE(hashqueue, lookup, probe_distance + 1);
+            return (int) table_index;
+        } else if (slots[table_index].probe_distance == SLOT_EMPTY) {
+            STATS_PROBE(hashqueue, lookup, probe_distance + 1);
+            return -1;
+        } else {
+            table_index = (table_index + 1) & table_mask;
+            ++ probe_distance;
+        }
+    }
+    STATS_PROBE(hashqueue, lookup, probe_distance + 1);
+    return -1;
+}
+
+/*  
+    Table Repair procedure (backward shift deletion)
+        - Inspect the slot following the one just emptied
+        - If it holds an entry displaced from its ideal slot, shift it back by one
+        - continue until we find an empty slot, or an entry already in its ideal slot
+    Works on either the live table or, mid-migration, the old table.
+    Returns the number of entries shifted.
+*/
+
+static int HashQueue_tableRepair(u32 empty_index, Entry **table, Slot *slots, int capacity) {
+    const u32 table_mask = capacity - 1;
+    u32 inspect_index = (empty_index + 1) & table_mask;                     // we inspect the following index
+    int moves = 0;
+
+    // SLOT_EMPTY never counts as displaced
+    while (slots[inspect_index].probe_distance != SLOT_EMPTY && slots[inspect_index].probe_distance > 0) {
+        SHARED_STORE(table[empty_index], table[inspect_index]); // shift the displaced entry back into the empty slot
+        table[empty_index] -> table_index = empty_index;        // reflect new position inside the Entry
+        SHARED_STORE(slots[empty_index].id, slots[inspect_index].id);
+        SHARED_STORE(slots[empty_index].probe_distance, slots[inspect_index].probe_distance - 1); // one step closer to its ideal slot
+
+        SHARED_STORE(table[inspect_index], NULL);               // empty the inspect index, as we have moved the entry
+        SHARED_STORE(slots[inspect_index].probe_distance, SLOT_EMPTY);
+
+        empty_index = inspect_index;
+        inspect_index = (inspect_index + 1) & table_mask;       // move on to inspect next slot
+        ++ moves;
+    }
+    return moves;
+}
+
+/*
+    - Empties slots [from, to)
+*/
+static void HashQueue_clearSlots(int from, int to, Entry **table, Slot *slots) {
+    for (int i = from; i < to; ++i) {
+        table[i] = NULL;
+        slots[i].id = 0;
+        slots[i].probe_distance = SLOT_EMPTY;
+    }
+}
+
+/*
+    - Allocates a table and its slots array, with every slot empty
+    Returns 0 if any malloc failed, 1 otherwise.
+*/
+static int HashQueue_allocTable(int capacity, Entry ***table, Slot **slots) {
+    *table = malloc(capacity * sizeof(Entry*));
+    *slots = malloc(capacity * sizeof(Slot));
+
+    if (*table == NULL || *slots == NULL) {
+        free(*table);
+        free(*slots);
+        return 0;
+    }
+
+    HashQueue_clearSlots(0, capacity, *table, *slots);
+    return 1;
+}
+
+/*
+    - Turns the load thresholds into _size limits for the current capacity,
+      so mutations compare integers and only resizing does floating point
+    - grow_at rounds down and shrink_at up, matching _size / capacity > max_load
+      and _size / capacity < shrink_threshold exactly
+*/
+static void HashQueue_setLimits(HashQueue *hashqueue) {
+    const double shrink_limit = hashqueue -> capacity * hashqueue -> shrink_threshold;
+    hashqueue -> grow_at = (int) (hashqueue -> capacity * hashqueue -> max_load);
+    hashqueue -> shrink_at = (int) shrink_limit;
+    if (hashqueue -> shrink_at < shrink_limit) {
+        ++ hashqueue -> shrink_at;
+    }
+}
+
+/*
+    - Doubles capacity until n Threads fit without exceeding max_load
+    Returns 0 if that takes more than MAX_CAPACITY slots, as a tiny max_load can.
+*/
+static int HashQueue_capacityFor(int n, double max_load, int capacity) {
+    while (n > capacity * max_load) {
+        if (capacity >= MAX_CAPACITY) {
+            return 0;
+        }
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+/*
+    Cluster repair procedure (after batch removals)
+        - Removed slots are first marked SLOT_TOMBSTONE, which still counts as occupied
+        - Walk back to the start of the cluster holding index, the slot after an empty one
+        - Sweep forward to the end of the cluster, clearing tombstones and moving each live entry
+          to the first free slot at or after its ideal slot
+    Entries in a Robin Hood cluster are ordered by ideal slot, so the sweep keeps that order,
+    and repairs any number of removals from the cluster in a single pass.
+    Returns the number of entries moved.
+*/
+static int HashQueue_repairCluster(u32 index, Entry **table, Slot *slots, int capacity) {
+    const u32 table_mask = capacity - 1;
+    u32 start = index;
+    int moves = 0;
+
+    while (slots[(start - 1) & table_mask].probe_distance != SLOT_EMPTY) {
+        start = (start - 1) & table_mask;
+    }
+
+    int write = 0;                                              // offset from start of the first free slot
+    for (int offset = 0; slots[(start + offset) & table_mask].probe_distance != SLOT_EMPTY; ++offset) {
+        const u32 inspect_index = (start + offset) & table_mask;
+
+        if (slots[inspect_index].probe_distance == SLOT_TOMBSTONE) {
+            SHARED_STORE(slots[inspect_index].probe_distance, SLOT_EMPTY);
+            continue;
+        }
+
+        const int ideal = offset - slots[inspect_index].probe_distance;
+        const int target = (ideal > write) ? ideal : write;
+
+        if (target != offset) {
+            const u32 target_index = (start + target) & table_mask;
+            SHARED_STORE(table[target_index], table[inspect_index]);
+            table[target_index] -> table_index = target_index;
+            SHARED_STORE(slots[target_index].id, slots[inspect_index].id);
+            SHARED_STORE(slots[target_index].probe_distance, target - ideal);
+
+            SHARED_STORE(table[inspect_index], NULL);
+            SHARED_STORE(slots[inspect_index].probe_distance, SLOT_EMPTY);
+            ++ moves;
+        }
+        write = target + 1;
+    }
+    return moves;
+}
+
+/*
+    - Empties a single slot, the caller repairs the table afterwards
+*/
+static void HashQueue_clearSlot(u32 table_index, Entry **table, Slot *slots) {
+    SHARED_STORE(table[table_index], NULL);
+    SHARED_STORE(slots[table_index].probe_distance, SLOT_EMPTY);
+}
+
+/*
+    - During an incremental rehash, Entries not yet migrated still live in old_table
+*/
+static int HashQueue_inOldTable(Entry *entry, HashQueue *hashqueue) {
+    return (hashqueue -> old_table != NULL &&
+            entry -> table_index < (u32) hashqueue -> old_capacity &&
+            hashqueue -> old_table[entry -> table_index] == entry);
+}
+
+/*
+    - Migrates up to max_entries Entries from old_table into table, visiting at most
+      REHASH_MIGRATE_VISITS slots per Entry so runs of empty slots are bounded too
+    - Each migrated slot is repaired, which may pull a later Entry back into it,
+      so the cursor only advances past empty slots
+    - Frees old_table once every slot has been visited
+*/
+static void HashQueue_migrate(HashQueue *hashqueue, int max_entries) {
+    Entry **old_table = hashqueue -> old_table;
+    Slot *old_slots = hashqueue -> old_slots;
+    const int old_capacity = hashqueue -> old_capacity;
+    long visits = (long) max_entries * REHASH_MIGRATE_VISITS;
+
+    while (max_entries > 0 && visits > 0 && hashqueue -> migrate_index < (u32) old_capacity) {
+        const u32 old_index = hashqueue -> migrate_index;
+        Entry *entry = old_table[old_index];
+        -- visits;
+
+        if (entry == NULL) {
+            ++ hashqueue -> migrate_index;
+            continue;
+        }
+
+        HashQueue_clearSlot(old_index, old_table, old_slots);
+        STATS_ADD(hashqueue, repair_moves, HashQueue_tableRepair(old_index, old_table, old_slots, old_capacity));
+
+        HashQueue_place(entry, hashqueue -> table, hashqueue -> slots, hashqueue -> capacity, hashqueue);
+        -- max_entries;
+    }
+
+    if (hashqueue -> migrate_index == (u32) old_capacity) {
+        HashQueue_retireTable(old_table, old_slots, hashqueue);
+        SHARED_STORE(hashqueue -> old_table, NULL);
+        SHARED_STORE(hashqueue -> old_slots, NULL);
+        SHARED_STORE(hashqueue -> old_capacity, 0);
+        hashqueue -> migrate_index = 0;
+    }
+}
+
+/*
+    - Completes any migration in progress, whatever its visit budget
+    An Entry budget of old_capacity is always enough, the loop only guards against that changing.
+*/
+static void HashQueue_migrateAll(HashQueue *hashqueue) {
+    while (hashqueue -> old_table != NULL) {
+        HashQueue_migrate(hashqueue, hashqueue -> old_capacity);
+    }
+}
+
+/*
+    - Makes the fully prepared next_table live, leaving every Entry in old_table
+      to be migrated by subsequent operations
+*/
+static void HashQueue_startMigration(HashQueue *hashqueue) {
+    const clock_t begin = STATS_CLOCK();
+    HashQueue_migrateAll(hashqueue);                           // a previous migration still running is finished first
+
+    const int new_capacity = (hashqueue -> capacity) * 2;
+    Entry **new_table = hashqueue -> next_table;
+    Slot *new_slots = hashqueue -> next_slots;
+    hashqueue -> next_table = NULL;
+    hashqueue -> next_slots = NULL;
+    hashqueue -> next_prepared = 0;
+
+    SHARED_STORE(hashqueue -> old_table, hashqueue -> table);
+    SHARED_STORE(hashqueue -> old_slots, hashqueue -> slots);
+    SHARED_STORE(hashqueue -> old_capacity, hashqueue -> capacity);
+    hashqueue -> migrate_index = 0;
+    SHARED_STORE(hashqueue -> table, new_table);
+    SHARED_STORE(hashqueue -> slots, new_slots);
+    SHARED_STORE(hashqueue -> capacity, new_capacity);
+    HashQueue_setLimits(hashqueue);
+    STATS_RESIZE(hashqueue, 1, begin);
+}
+
+/*
+    - Initialises up to max_slots more slots of next_table, starting the migration once all are ready
+*/
+static void HashQueue_prepare(HashQueue *hashqueue, int max_slots) {
+    const int next_capacity = (hashqueue -> capacity) * 2;
+    const int from = hashqueue -> next_prepared;
+    const int to = (next_capacity - from > max_slots) ? from + max_slots : next_capacity;
+
+    HashQueue_clearSlots(from, to, hashqueue -> next_table, hashqueue -> next_slots);
+    hashqueue -> next_prepared = to;
+    if (to == next_capacity) {
+        HashQueue_startMigration(hashqueue);
+    }
+}
+
+/*
+    - Incremental counterpart to HashQueue_rehash: allocates the doubled table without touching it,
+      so its initialisation can be spread over the following operations
+    Returns 0 if the new table could not be allocated (the old table is kept), 1 otherwise.
+*/
+static int HashQueue_startGrowth(HashQueue *hashqueue) {
+    if (hashqueue -> next_table != NULL) {                     // already growing
+        return 1;
+    }
+
+    const int next_capacity = (hashqueue -> capacity) * 2;
+    if (next_capacity > MAX_CAPACITY) {
+        return 0;
+    }
+    hashqueue -> next_table = malloc(next_capacity * sizeof(Entry*));
+    hashqueue -> next_slots = malloc(next_capacity * sizeof(Slot));
+    if (hashqueue -> next_table == NULL || hashqueue -> next_slots == NULL) {
+        free(hashqueue -> next_table);
+        free(hashqueue -> next_slots);
+        hashqueue -> next_table = NULL;
+        hashqueue -> next_slots = NULL;
+        return 0;
+    }
+    hashqueue -> next_prepared = 0;
+
+    if (hashqueue -> old_table == NULL) {
+        HashQueue_prepare(hashqueue, REHASH_PREPARE_STEP);    // small tables are ready at once
+    }
+    return 1;
+}
+
+/*
+    - Drops a pending growth, for eager resizes that choose their own capacity
+*/
+static void HashQueue_cancelGrowth(HashQueue *hashqueue) {
+    free(hashqueue -> next_table);
+    free(hashqueue -> next_slots);
+    hashqueue -> next_table = NULL;
+    hashqueue -> next_slots = NULL;
+    hashqueue -> next_prepared = 0;
+}
+
+/*
+    One operation's share of an incremental rehash
+        - Migrate from old_table if a migration is running, otherwise prepare next_table
+        - Should the live table fill up to three quarters before the growth completes, finish it at once,
+          so probing never degrades however the operations are mixed
+*/
+static void HashQueue_rehashStep(HashQueue *hashqueue) {
+    if (hashqueue -> old_table != NULL) {
+        HashQueue_migrate(hashqueue, REHASH_MIGRATE_STEP);
+    } else if (hashqueue -> next_table != NULL) {
+        HashQueue_prepare(hashqueue, REHASH_PREPARE_STEP);
+    }
+
+    if (hashqueue -> next_table != NULL && hashqueue -> _size >= hashqueue -> capacity - hashqueue -> capacity / 4) {
+        HashQueue_migrateAll(hashqueue);
+        HashQueue_prepare(hashqueue, hashqueue -> capacity * 2);
+    }
+}
+
+/*
+    Returns 0 if enqueue failed, 1 if succeeded.
+    Result 1 means t is queued: a growth that fails after placement is only counted in grow_failures,
+    and the next enqueue tries again. Result 0 means t was not queued at all, because no Entry could
+    be allocated, or the table is full after failed growths and could not grow now either.
+*/
+QueueResultPair HashQueue_enqueue(Thread *t, ThreadQueue *queue) {
+
+    HashQueue *hashqueue = (HashQueue*) queue;
+
     // Create new entry
-    Entry * new_entry = malloc(sizeof(Entry));
+    Entry * new_entry = EntryPool_alloc(&(hashqueue -> pool));
     if (new_entry == NULL) {
         printf("Entry memory allocation failed.\n");
         QueueResultPair result = {queue, 0};        // return old queue
         return result;
     }
 
+    HashQueue_writeBegin(hashqueue);
+    HashQueue_rehashStep(hashqueue);
+
+    // only reachable after failed growths, placing would take the last empty slot every probe needs
+    if (hashqueue -> _size >= hashqueue -> capacity - 1 && HashQueue_rehash(hashqueue) == 0) {
+        STATS_ADD(hashqueue, grow_failures, 1);
+        EntryPool_release(new_entry, &(hashqueue -> pool));
+        HashQueue_writeEnd(hashqueue);
+        QueueResultPair result = {queue, 0};
+        return result;
+    }
+
     new_entry -> prev = NULL;
     new_entry -> next = NULL;
-    new_entry -> t = t;
-    new_entry -> table_index = table_index;
+    SHARED_STORE(new_entry -> t, t);
     
     // Linked List pointers update
-    if (hashqueue -> isEmpty((ThreadQueue*) hashqueue)) {
+    if (hashqueue -> _size == 0) {
         hashqueue -> tail = hashqueue -> head = new_entry;
     } else {
         new_entry -> prev = hashqueue -> tail;
@@ -62,157 +775,480 @@ static QueueResultPair HashQueue_enqueue(Thread *t, ThreadQueue *queue) {
     }
     
 
-    hashqueue -> table[table_index] = new_entry;
+    // New entries always go to the live table, never to old_table
+    HashQueue_place(new_entry, hashqueue -> table, hashqueue -> slots, hashqueue -> capacity, hashqueue);
     ++ hashqueue -> _size;
 
-    hashqueue -> load_factor = (double) hashqueue -> _size / hashqueue -> capacity;
-    QueueResultPair result;
+    QueueResultPair result = {queue, 1};    // the queue never moves, even when rehashing
 
     // Check if rehashing required
-    if (hashqueue -> load_factor > REHASH_THRESHOLD) {
-        result = HashQueue_rehash(hashqueue);
-    } else {
-        result.queue = (ThreadQueue*) hashqueue;
-        result.result = 1;
+    if (hashqueue -> _size > hashqueue -> grow_at) {
+        const int grown = (hashqueue -> incremental_rehash) ? HashQueue_startGrowth(hashqueue) : HashQueue_rehash(hashqueue);
+        if (grown == 0) {
+            STATS_ADD(hashqueue, grow_failures, 1);
+        }
     }
 
+    HashQueue_writeEnd(hashqueue);
     return result;
 }
 
-/*  
-    Table Repair procedure
-        - Continue forward search until empty found
-        - Check each entry's ideal index.
-        - If it is less than the index we emptied, move this entry into the empty index
-        - continue until we find an empty slot
+static int HashQueue_resize(HashQueue *hashqueue, int new_capacity);
+
+/*
+    Batch enqueue procedure
+        - Grow the table once, to the capacity the whole batch needs, instead of rehashing on the way
+        - Build the new Entries into a sublist and splice it onto tail in one step
+        - Place the sublist into the table in a single pass
+    The resize is eager even with incremental_rehash: any migration is completed first, so every Entry lands in the live table.
+    If the table can't be grown up front, placing the whole batch could fill it, so each Thread is enqueued in turn instead.
+    result holds the number of Threads enqueued, fewer than n only if allocation failed.
 */
+static QueueResultPair HashQueue_enqueueBatch(Thread **threads, int n, ThreadQueue *queue) {
+    HashQueue *hashqueue = (HashQueue*) queue;
+    QueueResultPair result = {queue, 0};
 
-static void HashQueue_tableRepair(u32 empty_index, HashQueue *hashqueue) {
-    const u32 table_mask = (hashqueue -> capacity) - 1;
-    u32 inspect_index = (empty_index + 1) & table_mask;                     // we inspect the following index
-    u16 thread_id;
-    u32 ideal_index;                                                        // will store where an entry would ideally be placed
+    if (n <= 0) {
+        return result;
+    }
+
+    HashQueue_writeBegin(hashqueue);
+    HashQueue_migrateAll(hashqueue);
+
+    const int new_capacity = HashQueue_capacityFor(hashqueue -> _size + n, hashqueue -> max_load, hashqueue -> capacity);
+    if (new_capacity != hashqueue -> capacity && (new_capacity == 0 || HashQueue_resize(hashqueue, new_capacity) == 0)) {
+        STATS_ADD(hashqueue, grow_failures, 1);
+        HashQueue_writeEnd(hashqueue);
+        return ThreadQueue_enqueueEach(threads, n, queue);
+    }
+
+    // Sublist construction
+    Entry *first = NULL;
+    Entry *last = NULL;
+    int count = 0;
+
+    while (count < n) {
+        Entry *new_entry = EntryPool_alloc(&(hashqueue -> pool));
+        if (new_entry == NULL) {
+            printf("Entry memory allocation failed.\n");
+            break;
+        }
+
+        SHARED_STORE(new_entry -> t, threads[count]);
+        new_entry -> prev = last;
+        new_entry -> next = NULL;
+        if (last == NULL) {
+            first = new_entry;
+        } else {
+            last -> next = new_entry;
+        }
+        last = new_entry;
+        ++ count;
+    }
 
-    while (hashqueue -> table[inspect_index] != NULL) {
-        thread_id = hashqueue -> table[inspect_index] -> t -> id;
-        ideal_index = hashqueue -> getHash(thread_id) & table_mask;
+    if (count > 0) {
+        if (hashqueue -> tail == NULL) {
+            hashqueue -> head = first;
+        } else {
+            hashqueue -> tail -> next = first;
+            first -> prev = hashqueue -> tail;
+        }
+        hashqueue -> tail = last;
 
-        /* 
-            current entry is 'out of place'
-            or should not be moved backwards
-        */
-        if (!(ideal_index == inspect_index ||
-            (empty_index < ideal_index && ideal_index < inspect_index) ||
-            (ideal_index < inspect_index && inspect_index < empty_index) ||
-            (inspect_index < empty_index && empty_index < ideal_index)))
-        {                                         
-            hashqueue -> table[empty_index] = hashqueue -> table[inspect_index];    // store the out of place entry into the empty slot
-            hashqueue -> table[empty_index] -> table_index = empty_index;           // reflect new position inside the Entry
-            hashqueue -> table[inspect_index] = NULL;                               // empty the inspect index, as we have moved the entry
+        for (Entry *curr = first; curr != NULL; curr = curr -> next) {
+            HashQueue_place(curr, hashqueue -> table, hashqueue -> slots, hashqueue -> capacity, hashqueue);
+        }
 
-            empty_index = inspect_index;                                    
-        } 
-        
-        inspect_index = (inspect_index + 1) & table_mask;                           // move on to inspect next slot    
+        hashqueue -> _size += count;
+        if (hashqueue -> _size > hashqueue -> grow_at && HashQueue_rehash(hashqueue) == 0) {
+            STATS_ADD(hashqueue, grow_failures, 1);
+        }
     }
+
+    HashQueue_writeEnd(hashqueue);
+    result.result = count;
+    return result;
 }
 
 /*
-    - Once a cell is deleted, continue iterating to 'repair' any out of place entries, or until an empty cell is found
+    Batch dequeue procedure
+        - Detach a prefix of up to max Entries from the FIFO in one step
+        - Mark each of their slots SLOT_TOMBSTONE, so clusters keep their shape meanwhile
+        - Repair each cluster holding a tombstone once, with a single sweep
+    Any incremental migration is completed first, so every Entry is in the live table.
+    Returns the number of Threads written to out, oldest first.
 */
-static Thread *HashQueue_dequeue(ThreadQueue *queue) {
-    HashQueue* hashqueue = (HashQueue*) queue;
-    
-    if (hashqueue -> isEmpty((ThreadQueue*) hashqueue)) {
-        return NULL;
+static int HashQueue_dequeueN(Thread **out, int max, ThreadQueue *queue) {
+    HashQueue *hashqueue = (HashQueue*) queue;
+
+    HashQueue_drainInbox(hashqueue);
+
+    if (max <= 0 || hashqueue -> _size == 0) {
+        return 0;
     }
 
-    Entry *entry = hashqueue -> head;
-    const u32 table_index = entry -> table_index;   // attained directly without search
+    HashQueue_writeBegin(hashqueue);
+    HashQueue_migrateAll(hashqueue);
 
-    // Update hashqueue fields
-    hashqueue -> table[table_index] = NULL;
-    -- hashqueue -> _size;
-    hashqueue -> load_factor = (double) hashqueue -> _size / hashqueue -> capacity;
-    
+    Entry **table = hashqueue -> table;
+    Slot *slots = hashqueue -> slots;
+    Entry *first = hashqueue -> head;
+    Entry *curr = first;
+    int count = 0;
+
+    while (count < max && curr != NULL) {
+        out[count ++] = curr -> t;
+        SHARED_STORE(table[curr -> table_index], NULL);
+        SHARED_STORE(slots[curr -> table_index].probe_distance, SLOT_TOMBSTONE);
+        curr = curr -> next;
+    }
 
-    // Update Linked List pointers
-    if (hashqueue -> tail == hashqueue -> head) {   // we are removing lone entry in hashqueue
+    // Detach the prefix, curr is the new head
+    hashqueue -> head = curr;
+    if (curr == NULL) {
         hashqueue -> tail = NULL;
-        hashqueue -> head = NULL;
-    } else {                            // there is at least one other entry
+    } else {
+        curr -> prev = NULL;
+    }
+
+    Entry *entry = first;
+    while (entry != curr) {
         Entry *next = entry -> next;
-        next -> prev = NULL;
-        hashqueue -> head = next;
+        if (slots[entry -> table_index].probe_distance == SLOT_TOMBSTONE) {     // not already swept by an earlier repair
+            STATS_ADD(hashqueue, repair_moves, HashQueue_repairCluster(entry -> table_index, table, slots, hashqueue -> capacity));
+        }
+        EntryPool_release(entry, &(hashqueue -> pool));
+        entry = next;
     }
 
-    HashQueue_tableRepair(table_index, hashqueue);
+    hashqueue -> _size -= count;
+    if (hashqueue -> _size < hashqueue -> shrink_at) {
+        HashQueue_shrink(hashqueue);
+    }
 
-    Thread *th = entry -> t;
-    free(entry);
-    return th;
+    HashQueue_writeEnd(hashqueue);
+    return count;
+}
 
+/*
+    - Unlinks an Entry from the FIFO only, its slot is left to the caller
+*/
+static void HashQueue_unlink(Entry *entry, HashQueue *hashqueue) {
+    if (entry -> prev == NULL) {
+        hashqueue -> head = entry -> next;
+    } else {
+        entry -> prev -> next = entry -> next;
+    }
+    if (entry -> next == NULL) {
+        hashqueue -> tail = entry -> prev;
+    } else {
+        entry -> next -> prev = entry -> prev;
+    }
 }
 
+/*
+    Bulk removal procedure, for tearing down whole groups of threads
+        - Sweep the table once, unlinking every Entry whose ID is set in the ids bitmap
+          (ID_BITMAP_WORDS words) and marking its slot SLOT_TOMBSTONE
+        - Sweep again, repairing each cluster still holding a tombstone once
+    O(capacity) whatever the number of IDs, rather than a probe and repair per ID.
+    Duplicate IDs are all removed. Returns the number of Entries removed.
+*/
+int HashQueue_removeByIDs(const u32 *ids, HashQueue *hashqueue) {
+    HashQueue_drainInbox(hashqueue);
 
-static Thread *HashQueue_removeByID(u16 thread_id, ThreadQueue *queue) {
-    HashQueue *hashqueue = (HashQueue*) queue;
-    const u32 table_mask = (hashqueue -> capacity) - 1;
-    u32 inspect_index = hashqueue -> getHash(thread_id) & table_mask;
+    HashQueue_writeBegin(hashqueue);
+    HashQueue_migrateAll(hashqueue);
 
-    while (hashqueue -> table[inspect_index] != NULL)
-    {
-        Entry *curr = hashqueue -> table[inspect_index];
-
-        if (curr -> t -> id == thread_id) { // Found
-            // Linked List pointers update
-            Entry * prev = curr -> prev;
-            Entry * next = curr -> next;
-            if (prev == NULL && next == NULL) { // removing lone entry in the hashqueue
-                hashqueue -> head = hashqueue -> tail = NULL;
-            } else if (prev == NULL) {          // we are removing the head
-                next -> prev = NULL;    
-                hashqueue -> head = next;    
-            } else if (next == NULL) {          // we are removing the tail
-                prev -> next = NULL;
-                hashqueue -> tail = prev;
-            } else {                            // we are removing an intermediate node
-                next -> prev = prev;
-                prev -> next = next;
+    Entry **table = hashqueue -> table;
+    Slot *slots = hashqueue -> slots;
+    const int capacity = hashqueue -> capacity;
+    int count = 0;
+
+    for (int i = 0; i < capacity; ++i) {
+        if (slots[i].probe_distance == SLOT_EMPTY || !ID_BITMAP_TEST(ids, slots[i].id)) {
+            continue;
+        }
+
+        Entry *entry = table[i];
+        HashQueue_unlink(entry, hashqueue);
+
+        SHARED_STORE(table[i], NULL);
+        SHARED_STORE(slots[i].probe_distance, SLOT_TOMBSTONE);
+        EntryPool_release(entry, &(hashqueue -> pool));
+        ++ count;
+    }
+
+    if (count > 0) {
+        for (int i = 0; i < capacity; ++i) {
+            if (slots[i].probe_distance == SLOT_TOMBSTONE) {
+                STATS_ADD(hashqueue, repair_moves, HashQueue_repairCluster(i, table, slots, capacity));
             }
-            // Table fields update
-            hashqueue -> table[inspect_index] = NULL;       // remove entry from table
-            -- hashqueue -> _size;                           // record _size change
-            hashqueue -> load_factor = (double) hashqueue -> _size / hashqueue -> capacity;
-            Thread* found = curr -> t;
-
-            HashQueue_tableRepair(inspect_index, hashqueue);
-            free(curr);                                     // free Entry
-            return found;
-        } else {
-            inspect_index = (inspect_index + 1) & table_mask;
+        }
+
+        hashqueue -> _size -= count;
+        if (hashqueue -> _size < hashqueue -> shrink_at) {
+            HashQueue_shrink(hashqueue);
         }
     }
 
+    HashQueue_writeEnd(hashqueue);
+    return count;
+}
+
+/*
+    Filtered removal procedure, e.g. for evicting stale threads
+        - Walk the FIFO once, unlinking every Entry whose Thread satisfies predicate(t, ctx)
+          and marking its slot SLOT_TOMBSTONE
+        - Repair each affected cluster once, then release the unlinked Entries
+    predicate must not modify the queue. Returns the number of Entries removed.
+*/
+int HashQueue_removeIf(int (*predicate) (Thread*, void*), void *ctx, HashQueue *hashqueue) {
+    HashQueue_drainInbox(hashqueue);
+
+    HashQueue_writeBegin(hashqueue);
+    HashQueue_migrateAll(hashqueue);
+
+    Entry **table = hashqueue -> table;
+    Slot *slots = hashqueue -> slots;
+    Entry *removed = NULL;                                      // unlinked Entries, chained through next
+    Entry *entry;
+    Entry *n;
+    int count = 0;
+
+    hashqueue_for_each_entry_safe(entry, n, hashqueue) {
+        if (!predicate(entry -> t, ctx)) {
+            continue;
+        }
+
+        HashQueue_unlink(entry, hashqueue);
+        SHARED_STORE(table[entry -> table_index], NULL);
+        SHARED_STORE(slots[entry -> table_index].probe_distance, SLOT_TOMBSTONE);
+
+        entry -> next = removed;
+        removed = entry;
+        ++ count;
+    }
+
+    while (removed != NULL) {
+        Entry *next = removed -> next;
+        if (slots[removed -> table_index].probe_distance == SLOT_TOMBSTONE) {   // not already swept by an earlier repair
+            STATS_ADD(hashqueue, repair_moves, HashQueue_repairCluster(removed -> table_index, table, slots, hashqueue -> capacity));
+        }
+        EntryPool_release(removed, &(hashqueue -> pool));
+        removed = next;
+    }
+
+    if (count > 0) {
+        hashqueue -> _size -= count;
+        if (hashqueue -> _size < hashqueue -> shrink_at) {
+            HashQueue_shrink(hashqueue);
+        }
+    }
+
+    HashQueue_writeEnd(hashqueue);
+    return count;
+}
+
+/*
+    - Generic dequeueN for queues without a specialised one, dequeues one Thread at a time
+*/
+int ThreadQueue_dequeueEach(Thread **out, int max, ThreadQueue *queue) {
+    int count = 0;
+
+    while (count < max) {
+        Thread *t = queue -> dequeue(queue);
+        if (t == NULL) {
+            break;
+        }
+        out[count ++] = t;
+    }
+    return count;
+}
+
+/*
+    - Generic enqueueBatch for queues without a specialised one, enqueues each Thread in turn
+    Stops at the first failed enqueue, result holds the number of Threads enqueued.
+    Backends return 0 only for a Thread they did not queue, so the count is exact.
+*/
+QueueResultPair ThreadQueue_enqueueEach(Thread **threads, int n, ThreadQueue *queue) {
+    QueueResultPair result = {queue, 0};
+
+    for (int i = 0; i < n; ++i) {
+        if (queue -> enqueue(threads[i], queue).result == 0) {
+            break;
+        }
+        ++ result.result;
+    }
+    return result;
+}
+
+/*
+    - Removes an Entry from the FIFO and whichever table holds it,
+      repairing the table and returning the Entry to the pool
+*/
+static Thread *HashQueue_removeEntry(Entry *entry, HashQueue *hashqueue) {
+    // Linked List pointers update
+    Entry * prev = entry -> prev;
+    Entry * next = entry -> next;
+    if (prev == NULL && next == NULL) { // removing lone entry in the hashqueue
+        hashqueue -> head = hashqueue -> tail = NULL;
+    } else if (prev == NULL) {          // we are removing the head
+        next -> prev = NULL;    
+        hashqueue -> head = next;    
+    } else if (next == NULL) {          // we are removing the tail
+        prev -> next = NULL;
+        hashqueue -> tail = prev;
+    } else {                            // we are removing an intermediate node
+        next -> prev = prev;
+        prev -> next = next;
+    }
+
+    // Table fields update
+    const u32 table_index = entry -> table_index;   // attained directly without search
+    if (HashQueue_inOldTable(entry, hashqueue)) {
+        HashQueue_clearSlot(table_index, hashqueue -> old_table, hashqueue -> old_slots);
+        STATS_ADD(hashqueue, repair_moves, HashQueue_tableRepair(table_index, hashqueue -> old_table, hashqueue -> old_slots, hashqueue -> old_capacity));
+    } else {
+        HashQueue_clearSlot(table_index, hashqueue -> table, hashqueue -> slots);
+        STATS_ADD(hashqueue, repair_moves, HashQueue_tableRepair(table_index, hashqueue -> table, hashqueue -> slots, hashqueue -> capacity));
+    }
+    -- hashqueue -> _size;                           // record _size change
+
+    Thread *found = entry -> t;
+    EntryPool_release(entry, &(hashqueue -> pool));  // return Entry to the pool
+
+    // Check if the table should shrink to follow the live thread count
+    if (hashqueue -> _size < hashqueue -> shrink_at) {
+        HashQueue_shrink(hashqueue);
+    }
+
+    return found;
+}
+
+/*
+    - Searches the live table, then old_table if a migration is in progress
+*/
+static Entry *HashQueue_findEntry(u16 thread_id, HashQueue *hashqueue) {
+    int table_index = HashQueue_findSlot(thread_id, hashqueue -> slots, hashqueue -> capacity, hashqueue);
+    if (table_index != -1) {
+        return hashqueue -> table[table_index];
+    }
+
+    if (hashqueue -> old_table != NULL) {
+        table_index = HashQueue_findSlot(thread_id, hashqueue -> old_slots, hashqueue -> old_capacity, hashqueue);
+        if (table_index != -1) {
+            return hashqueue -> old_table[table_index];
+        }
+    }
     return NULL;
+}
 
+/*
+    Lock-free wakeup inbox (multi-producer, single-consumer)
+        - Any CPU may post a Thread with a single CAS on the inbox head, without touching the queue itself
+        - Only the owning CPU drains, swapping the whole list out in one exchange
+        - The list is built newest first, so draining reverses it to enqueue in posting order
+    Posted Threads are not visible to contains/getByID/size until drained, which dequeue does first.
+*/
+void HashQueue_post(Thread *t, HashQueue *hashqueue) {
+    Thread *head = atomic_load_explicit(&(hashqueue -> inbox), memory_order_relaxed);
+    do {
+        t -> wake_next = head;
+    } while (!atomic_compare_exchange_weak_explicit(&(hashqueue -> inbox), &head, t,
+                                                    memory_order_release, memory_order_relaxed));
 }
 
-static Thread *HashQueue_getByID(u16 thread_id, ThreadQueue* queue) {
-    HashQueue* hashqueue = (HashQueue*) queue;
-    const u32 table_mask = (hashqueue -> capacity) - 1;
-    u32 table_index = hashqueue -> getHash(thread_id) & table_mask;
+/*
+    - Moves every posted Thread into the FIFO and table, owning CPU only
+    Returns the number of Threads enqueued. Threads that could not be enqueued, so are in neither FIFO
+    nor table, are posted back.
+*/
+int HashQueue_drainInbox(HashQueue *hashqueue) {
+    if (atomic_load_explicit(&(hashqueue -> inbox), memory_order_relaxed) == NULL) {
+        return 0;
+    }
 
-    while (hashqueue -> table[table_index] != NULL)
-    {
-        Entry* curr = hashqueue -> table[table_index];
-        if (curr -> t -> id == thread_id) {
-            return curr -> t;
+    Thread *posted = atomic_exchange_explicit(&(hashqueue -> inbox), NULL, memory_order_acquire);
+    Thread *ordered = NULL;
+
+    while (posted != NULL) {                    // reverse into posting order
+        Thread *next = posted -> wake_next;
+        posted -> wake_next = ordered;
+        ordered = posted;
+        posted = next;
+    }
+
+    int drained = 0;
+    while (ordered != NULL) {
+        Thread *next = ordered -> wake_next;
+        ordered -> wake_next = NULL;
+        if (HashQueue_enqueue(ordered, (ThreadQueue*) hashqueue).result == 0) {
+            HashQueue_post(ordered, hashqueue);
         } else {
-            table_index = (table_index + 1) & table_mask;
+            ++ drained;
         }
+        ordered = next;
     }
-    return NULL;
+    return drained;
+}
+
+/*
+    - Once a cell is deleted, continue iterating to 'repair' any out of place entries, or until an empty cell is found
+*/
+Thread *HashQueue_dequeue(ThreadQueue *queue) {
+    HashQueue* hashqueue = (HashQueue*) queue;
+
+    HashQueue_drainInbox(hashqueue);
+    
+    if (hashqueue -> _size == 0) {
+        return NULL;
+    }
+
+    HashQueue_writeBegin(hashqueue);
+    HashQueue_rehashStep(hashqueue);
+
+    Thread *t = HashQueue_removeEntry(hashqueue -> head, hashqueue);
+    HashQueue_writeEnd(hashqueue);
+    return t;
+}
+
+
+Thread *HashQueue_removeByID(u16 thread_id, ThreadQueue *queue) {
+    HashQueue *hashqueue = (HashQueue*) queue;
+    Thread *t = NULL;
+
+    HashQueue_writeBegin(hashqueue);
+    HashQueue_rehashStep(hashqueue);
+
+    Entry *entry = HashQueue_findEntry(thread_id, hashqueue);
+    if (entry != NULL) {
+        t = HashQueue_removeEntry(entry, hashqueue);
+    }
+    HashQueue_writeEnd(hashqueue);
+    return t;
+}
+
+/*
+    - Removes the most recently enqueued Thread, NULL if empty
+    Used to steal work from the cold end of the FIFO.
+*/
+Thread *HashQueue_removeTail(HashQueue *hashqueue) {
+    if (hashqueue -> tail == NULL) {
+        return NULL;
+    }
+
+    HashQueue_writeBegin(hashqueue);
+    HashQueue_rehashStep(hashqueue);
+
+    Thread *t = HashQueue_removeEntry(hashqueue -> tail, hashqueue);
+    HashQueue_writeEnd(hashqueue);
+    return t;
+}
+
+static Thread *HashQueue_getByID(u16 thread_id, ThreadQueue* queue) {
+    Entry *entry = HashQueue_findEntry(thread_id, (HashQueue*) queue);
+    return (entry == NULL) ? NULL : entry -> t;
 }
 
 static int HashQueue_contains(u16 thread_id, ThreadQueue* queue) {
@@ -229,38 +1265,16 @@ static int HashQueue_size(ThreadQueue* queue) {
     return hashqueue -> _size;
 }
 
+/*
+    - Mid-migration, the returned index may refer to old_table
+*/
 static int HashQueue_getTableIndexByID(u16 thread_id, ThreadQueue* queue) {
-    HashQueue* hashqueue = (HashQueue*) queue;
-    const u32 table_mask = (hashqueue -> capacity) - 1;
-    u32 table_index = hashqueue -> getHash(thread_id) & table_mask;
-
-    while (hashqueue -> table[table_index] != NULL)
-    {
-        Entry *curr = hashqueue -> table[table_index];
-        if (curr -> t -> id == thread_id) {
-            return (int) table_index;
-        } else {
-            table_index = (table_index + 1) & table_mask;
-        }
-    }
-    return -1;
+    Entry *entry = HashQueue_findEntry(thread_id, (HashQueue*) queue);
+    return (entry == NULL) ? -1 : (int) entry -> table_index;
 }
 
 static Entry *HashQueue_getEntryByID(u16 thread_id, ThreadQueue* queue) {
-    HashQueue* hashqueue = (HashQueue*) queue;
-    const u32 table_mask = (hashqueue -> capacity) - 1;
-    u32 table_index = hashqueue -> getHash(thread_id) & table_mask;
-
-    while (hashqueue -> table[table_index] != NULL)
-    {
-        Entry* curr = hashqueue -> table[table_index];
-        if (curr -> t -> id == thread_id) {
-            return curr;
-        } else {
-            table_index = (table_index + 1) & table_mask;
-        }
-    }
-    return NULL;
+    return HashQueue_findEntry(thread_id, (HashQueue*) queue);
 }
 
 //----------------------------------- ITERATOR FUNCTIONS  -----------------------------------------
@@ -284,6 +1298,8 @@ static Iterator* new_Iterator(ThreadQueue* queue) {
     iterator -> hasNext = Iterator_hasNext;
     iterator -> next = Iterator_next;
     iterator -> currentEntry = hashqueue -> head;
+    iterator -> queue = queue;
+    iterator -> remaining = 0;
 
     return iterator;
 }
@@ -291,37 +1307,57 @@ static Iterator* new_Iterator(ThreadQueue* queue) {
 //----------------------------------- CONSTRUCTORS + DESTRUCTOR -----------------------------------
 
 /*
-    - Frees the entries in a table provided they are marked as occupied
+    - Releases every Entry at once by tearing down the pool's slabs
 */
 static void HashQueue_free(ThreadQueue *queue) {
     HashQueue *hashqueue = (HashQueue*) queue;
-    // Free each entry in the hash table
-    for (int i = 0; i < hashqueue -> capacity; ++i) {
-        if (hashqueue -> table[i] != NULL) {
-            free(hashqueue -> table[i]);
-        }
-    }
+    EntryPool_free(&(hashqueue -> pool));
     free(hashqueue -> table);
+    free(hashqueue -> slots);
+    free(hashqueue -> old_table);
+    free(hashqueue -> old_slots);
+    free(hashqueue -> next_table);
+    free(hashqueue -> next_slots);
+    HashQueue_freeRetired(hashqueue -> retired);
     free(hashqueue);
 }
 
 
 /*
+    - Shrinking stays below max_load / 2, so a halved table is not immediately regrown
     Returns 0 if any malloc failed, 1 otherwise.
 */
-int init_HashQueue(HashQueue *this) {
+static int HashQueue_init(HashQueue *this, int capacity, double max_load) {
     this -> _size = 0;
-    this -> capacity = INITIAL_CAPACITY;
-    this -> load_factor = 0.0;
+    this -> capacity = capacity;
     this -> head = NULL;
     this -> tail = NULL;
-    this -> table = malloc(INITIAL_CAPACITY * sizeof(Entry*));
-    if (this -> table == NULL) {
+    this -> max_load = max_load;
+    this -> shrink_threshold = (max_load / 4 < SHRINK_THRESHOLD) ? max_load / 4 : SHRINK_THRESHOLD;
+    this -> min_capacity = capacity;
+    HashQueue_setLimits(this);
+    this -> incremental_rehash = 0;
+    this -> old_table = NULL;
+    this -> old_slots = NULL;
+    this -> old_capacity = 0;
+    this -> migrate_index = 0;
+    this -> next_table = NULL;
+    this -> next_slots = NULL;
+    this -> next_prepared = 0;
+    atomic_init(&(this -> inbox), NULL);
+    atomic_init(&(this -> seq), 0);
+    atomic_init(&(this -> readers), 0);
+    this -> write_depth = 0;
+    this -> retired = NULL;
+    HashQueue_resetStats(this);
+    if (HashQueue_allocTable(capacity, &(this -> table), &(this -> slots)) == 0) {
         return 0;
     }
-    
-    for (int i = 0; i < INITIAL_CAPACITY; ++i) {
-        this -> table[i] = NULL;        // explicitly set Entry pointers to null   
+
+    if (init_EntryPool(&(this -> pool)) == 0) {
+        free(this -> table);
+        free(this -> slots);
+        return 0;
     }
 
     
@@ -334,6 +1370,8 @@ int init_HashQueue(HashQueue *this) {
     this -> iterator = new_Iterator;
     this -> size = HashQueue_size;
     this -> freeQueue = HashQueue_free;
+    this -> enqueueBatch = HashQueue_enqueueBatch;
+    this -> dequeueN = HashQueue_dequeueN;
     this -> getHash = FNV1AHash;
     this -> getTableIndexByID = HashQueue_getTableIndexByID;
     this -> getEntryByID = HashQueue_getEntryByID;
@@ -341,6 +1379,33 @@ int init_HashQueue(HashQueue *this) {
     return 1;
 }
 
+/*
+    Returns 0 if any malloc failed, 1 otherwise.
+*/
+int init_HashQueue(HashQueue *this) {
+    return HashQueue_init(this, INITIAL_CAPACITY, REHASH_THRESHOLD);
+}
+
+/*
+    - Sizes the table once, so capacity_hint Threads fit without rehashing
+    - max_load replaces REHASH_THRESHOLD for this queue, values outside (0,1) select REHASH_THRESHOLD
+    Returns 0 if the hint needs more than MAX_CAPACITY slots at max_load, or any malloc failed, 1 otherwise.
+*/
+int init_HashQueue_with(HashQueue *this, int capacity_hint, double max_load) {
+    if (!(max_load > 0.0 && max_load < 1.0)) {
+        max_load = REHASH_THRESHOLD;
+    }
+    if (capacity_hint > MAX_THREADS) {
+        capacity_hint = MAX_THREADS;
+    }
+
+    const int capacity = HashQueue_capacityFor(capacity_hint, max_load, MIN_CAPACITY);
+    if (capacity == 0) {
+        return 0;
+    }
+    return HashQueue_init(this, capacity, max_load);
+}
+
 /*
     - Allocates Memory for the HashQueue, then populates with init_HashQueue
 */
@@ -351,84 +1416,135 @@ HashQueue *new_HashQueue() {
     }
     int successful_initialisation = init_HashQueue(this);
     if (successful_initialisation == 0) { // if some memory allocoation failed during construction
+        free(this);
         return NULL;
     } else {
         return this;
     }
 }
 
+HashQueue *new_HashQueue_with(int capacity_hint, double max_load) {
+    HashQueue *this = malloc(sizeof(HashQueue));
+    if (this == NULL) {
+        return NULL;
+    }
+    if (init_HashQueue_with(this, capacity_hint, max_load) == 0) {
+        free(this);
+        return NULL;
+    }
+    return this;
+}
+
 
 /*
-    - Doubles the table size
-    - Copies each Entry pointer into its new table slot
-    - Sets occupied fields to zero in old table so entries are not freed
+    - Allocates a table of new_capacity slots
+    - Copies each Entry pointer into its new table slot, following the FIFO
     - Frees the old table
+    Only the table is reallocated, so the HashQueue keeps its address and its Entry pool.
+    Always eager: any incremental migration in progress is completed first, and a doubled table still
+    being prepared is dropped. Shrinking and reserve come through here.
+    Returns 0 if the new table could not be allocated (the old table is kept), 1 otherwise.
 */
-QueueResultPair HashQueue_rehash(HashQueue* old_queue) {
-    // New table initialisation
-    HashQueue *new_queue = malloc(sizeof(HashQueue));
+static int HashQueue_resize(HashQueue *hashqueue, int new_capacity) {
+    const clock_t begin = STATS_CLOCK();
+    HashQueue_migrateAll(hashqueue);
+    HashQueue_cancelGrowth(hashqueue);
 
-    if (new_queue == NULL) {    // If memory allocation failed return the old queue
-        QueueResultPair result = {(ThreadQueue*) old_queue, 0};
-        return result;
+    Entry **new_table;
+    Slot *new_slots;
+
+    if (HashQueue_allocTable(new_capacity, &new_table, &new_slots) == 0) {
+        return 0;
     }
 
-    new_queue -> _size = old_queue -> _size;
-    new_queue -> capacity = (old_queue -> capacity) * 2;
-    new_queue -> load_factor = (double) new_queue -> _size / new_queue -> capacity;
+    // Rehashing procedure
+    Entry *curr = hashqueue -> head;
 
-    new_queue -> head = old_queue -> head;
-    new_queue -> tail = old_queue -> tail;
-    new_queue -> table = malloc((new_queue -> capacity) * sizeof(Entry*));
-    
-    if (new_queue -> table == NULL) {
-        // returns the old queue as malloc failed
-        QueueResultPair result = {(ThreadQueue*) old_queue, 0};
-        return result;
+    while (curr != NULL) {
+        HashQueue_place(curr, new_table, new_slots, new_capacity, hashqueue);
+        curr = curr -> next;
     }
 
-    // Set occupied indices to 0 to begin
-    for (int i = 0; i < new_queue -> capacity; ++i) {
-        new_queue -> table[i] = NULL;
+    HashQueue_retireTable(hashqueue -> table, hashqueue -> slots, hashqueue);
+    SHARED_STORE(hashqueue -> table, new_table);
+    SHARED_STORE(hashqueue -> slots, new_slots);
+    const int grew = new_capacity > hashqueue -> capacity;
+    SHARED_STORE(hashqueue -> capacity, new_capacity);
+    HashQueue_setLimits(hashqueue);
+    STATS_RESIZE(hashqueue, grew, begin);
+    return 1;
+}
+
+/*
+    - Doubles the table size
+    Returns 0 if the table is already at MAX_CAPACITY or could not be allocated, 1 otherwise.
+*/
+int HashQueue_rehash(HashQueue *hashqueue) {
+    if (hashqueue -> capacity >= MAX_CAPACITY) {
+        return 0;
     }
+    HashQueue_writeBegin(hashqueue);
+    const int result = HashQueue_resize(hashqueue, (hashqueue -> capacity) * 2);
+    HashQueue_writeEnd(hashqueue);
+    return result;
+}
 
-    new_queue -> dequeue = HashQueue_dequeue;
-    new_queue -> contains = HashQueue_contains;
-    new_queue -> enqueue = HashQueue_enqueue;
-    new_queue -> isEmpty = HashQueue_isEmpty;
-    new_queue -> removeByID = HashQueue_removeByID;
-    new_queue -> getByID = HashQueue_getByID;
-    new_queue -> iterator = new_Iterator;
-    new_queue -> size = HashQueue_size;
-    new_queue -> freeQueue = HashQueue_free;
-    new_queue -> getHash = old_queue -> getHash;
-    new_queue -> getTableIndexByID = HashQueue_getTableIndexByID;
-    new_queue -> getEntryByID = HashQueue_getEntryByID;
+/*
+    - Halves the table size, never going below min_capacity
+    Returns 0 if the table is already at its minimum or allocation failed, 1 otherwise.
+*/
+int HashQueue_shrink(HashQueue *hashqueue) {
+    if (hashqueue -> capacity <= hashqueue -> min_capacity) {
+        return 0;
+    }
 
+    HashQueue_writeBegin(hashqueue);
+    const int result = HashQueue_resize(hashqueue, (hashqueue -> capacity) / 2);
+    HashQueue_writeEnd(hashqueue);
+    return result;
+}
 
-    // Rehashing procedure
-    const u32 table_mask = (new_queue -> capacity) - 1;
-    u32 new_table_index;
-    u32 old_table_index;
-    Entry *curr = old_queue -> head;
-    
-    while (curr != NULL) {
-        old_table_index = curr -> table_index;
-        new_table_index = new_queue -> getHash(curr -> t -> id) & table_mask;
-        while (new_queue -> table[new_table_index] != NULL) {
-                new_table_index = (new_table_index + 1) & table_mask;
-        }
-        new_queue -> table[new_table_index] = curr;
-        old_queue -> table[old_table_index] = NULL;
-        curr -> table_index = new_table_index;
-        curr = curr -> next;
+/*
+    - Grows the table once, so n Threads fit without rehashing during a burst of enqueues
+    - The table then never shrinks below the reserved size
+    - Eager even with incremental_rehash, as the reservation exists to take the cost up front
+    Returns 0 if n needs more than MAX_CAPACITY slots or the table could not be allocated (the old table is kept), 1 otherwise.
+*/
+int HashQueue_reserve(int n, HashQueue *hashqueue) {
+    if (n > MAX_THREADS) {
+        n = MAX_THREADS;
     }
 
-    
+    const int reserved = HashQueue_capacityFor(n, hashqueue -> max_load, MIN_CAPACITY);
+    if (reserved == 0) {
+        return 0;
+    }
+    if (reserved > hashqueue -> capacity) {
+        HashQueue_writeBegin(hashqueue);
+        const int result = HashQueue_resize(hashqueue, reserved);
+        HashQueue_writeEnd(hashqueue);
+        if (result == 0) {
+            return 0;
+        }
+    }
 
-    old_queue -> freeQueue((ThreadQueue*) old_queue);
-    QueueResultPair result;
-    result.queue = (ThreadQueue*) new_queue;
-    result.result = 1;
-    return result;
+    if (reserved > hashqueue -> min_capacity) {
+        hashqueue -> min_capacity = reserved;
+    }
+    return 1;
+}
+
+/*
+    - _size / capacity, computed on demand as mutations only track grow_at and shrink_at
+*/
+double HashQueue_loadFactor(HashQueue *hashqueue) {
+    return (double) hashqueue -> _size / hashqueue -> capacity;
+}
+
+/*
+    - 0 disables shrinking
+*/
+void HashQueue_setShrinkThreshold(double shrink_threshold, HashQueue *hashqueue) {
+    hashqueue -> shrink_threshold = shrink_threshold;
+    HashQueue_setLimits(hashqueue);
 }
@@ -1,20 +1,42 @@
 #ifndef HASH_QUEUE_H
 #define HASH_QUEUE_H
 
+#include <stdatomic.h>
+
 #include "list.h"
 
 typedef unsigned short u16;
 typedef unsigned int u32;
 typedef unsigned char u8;
+typedef unsigned long long u64;
 
 #define FNV_32_PRIME ((u32) 0x01000193)
 #define FNV_32_OFFSET_BASIS ((u32) 0x811c9dc5)
 #define FIRST_OCTET_MASK (0xff)
 #define SECOND_OCTET_MASK (0xff00)
+#define FIBONACCI_32_MULTIPLIER ((u32) 0x9e3779b1)      // 2^32 / golden ratio
+#define MURMUR_FMIX_C1 ((u32) 0x85ebca6b)
+#define MURMUR_FMIX_C2 ((u32) 0xc2b2ae35)
 
 #define INITIAL_CAPACITY 128
+#define MIN_CAPACITY 4                                     // smallest table new_HashQueue_with sizes for a capacity hint
+#define MAX_CAPACITY (1 << 20)                             // largest table, 16 slots per Thread ID, growth past it fails
 #define REHASH_THRESHOLD 0.5
+#define SHRINK_THRESHOLD 0.125                             // below REHASH_THRESHOLD / 2, so a halved table is not immediately regrown
+#define REHASH_MIGRATE_STEP 8                              // Entries migrated per operation during an incremental rehash
+#define REHASH_PREPARE_STEP 256                            // slots of the doubled table initialised per operation before migrating
+#define REHASH_MIGRATE_VISITS 4                            // old table slots visited per Entry migrated
 #define MAX_THREADS 65536
+#define CACHE_LINE_SIZE 64                                 // alignment of state that different CPUs write
+#define ENTRY_SLAB_SIZE 256                                // Entries carved out of each pool slab
+#define SLOT_EMPTY 0xFFFF                                  // Slot.probe_distance of an empty slot
+#define SLOT_TOMBSTONE 0xFFFE                              // Slot.probe_distance of a slot cleared by a batch removal, pending repair
+#define STATS_PROBE_BUCKETS 16                             // probe histogram buckets, longer probes share the last one
+
+// Sets of thread IDs, one bit per ID
+#define ID_BITMAP_WORDS (MAX_THREADS / 32)
+#define ID_BITMAP_SET(bitmap, id) ((bitmap)[(id) >> 5] |= (u32) 1 << ((id) & 31))
+#define ID_BITMAP_TEST(bitmap, id) (((bitmap)[(id) >> 5] >> ((id) & 31)) & 1)
 
 
 typedef struct Thread Thread;
@@ -23,11 +45,28 @@ typedef struct HashQueue HashQueue;
 typedef struct QueueResultPair QueueResultPair;
 typedef struct ThreadQueue ThreadQueue;
 typedef struct Iterator Iterator;
+typedef struct HashQueueCursor HashQueueCursor;
+typedef struct EntrySlab EntrySlab;
+typedef struct EntryPool EntryPool;
+typedef struct Slot Slot;
+typedef struct RetiredTable RetiredTable;
+typedef struct ProbeStats ProbeStats;
+typedef struct HashQueueStats HashQueueStats;
 
 
+/*
+    Fields past thread_list each belong to one backend, the rest never touch them:
+    - queue_index, wake_next and enqueue_seq are written by their backend before it reads them,
+      so callers need not initialise them
+    - priority is an input, it must be set before the Thread is enqueued on a PriorityQueue
+*/
 struct Thread {
     u16 id;
     struct list_head thread_list;
+    u32 queue_index;    // IntrusiveHashQueue: table slot while linked in
+    Thread *wake_next;  // HashQueue inbox: link while posted
+    u64 enqueue_seq;    // ShardedQueue: global FIFO position while queued
+    u8 priority;        // PriorityQueue: level, 0 is highest
 };
 
 struct Entry {
@@ -37,20 +76,91 @@ struct Entry {
     u32 table_index;    // allows dequeuing without search
 };
 
+/*
+    Probing metadata for one table slot, kept in a dense array parallel to the Entry pointer table.
+    A probe reads 16 slots per cache line and only follows table[i] once the id matches.
+*/
+struct Slot {
+    u16 id;             // copy of table[i] -> t -> id
+    u16 probe_distance; // slots between this slot and the ideal slot, used by Robin Hood probing, SLOT_EMPTY if unused
+};
+
+/*
+    Entries are carved out of fixed-size slabs owned by the queue.
+    Released Entries are kept on an intrusive free list (linked through Entry.next),
+    so steady-state enqueue/dequeue never touches the heap.
+*/
+struct EntrySlab {
+    EntrySlab *next;                    // slabs are chained so they can be torn down together
+    Entry entries[ENTRY_SLAB_SIZE];
+};
+
+struct EntryPool {
+    EntrySlab *slabs;
+    Entry *free_list;
+};
+
+/*
+    Probe lengths of one kind of table operation, counted in slots read
+*/
+struct ProbeStats {
+    u64 count;
+    u64 total;
+    u32 max;
+    u64 histogram[STATS_PROBE_BUCKETS];                    // histogram[i] counts probes of i + 1 slots
+};
+
+/*
+    HashQueue instrumentation, only recorded when built with HASHQUEUE_STATS.
+    Otherwise the queue carries no counters and HashQueue_getStats returns all zeroes.
+*/
+struct HashQueueStats {
+    ProbeStats insert;                                     // Robin Hood placements, including those done by rehashing
+    ProbeStats lookup;                                     // slot searches by ID
+    u64 repair_moves;                                      // Entries shifted back by table or cluster repair
+    u64 rehashes;                                          // table growths, incremental ones counted when they start
+    u64 shrinks;
+    u64 grow_failures;                                     // growths that could not allocate, the table kept its capacity
+    double rehash_ms;                                      // total time spent resizing tables
+    double max_rehash_ms;
+};
+
+/*
+    currentEntry, queue and remaining are set by every iterator constructor.
+    The union holds the cursor of backends that need more than currentEntry,
+    only the member of the backend that built the Iterator is ever set or read.
+*/
 struct Iterator {
     int (*hasNext) (Iterator*);
     Thread* (*next) (Iterator*);
     Entry *currentEntry;
+    ThreadQueue *queue;                 // queue being iterated
+    int remaining;                      // Threads left to return, kept by IndexQueue and ShardedQueue, 0 elsewhere
+    union {
+        struct {                        // IntrusiveHashQueue
+            struct list_head *currentNode;
+            struct list_head *listHead;
+        };
+        u16 currentIndex;               // IndexQueue entry index, PriorityQueue level
+        Entry **cursors;                // ShardedQueue, one Entry per shard
+    };
 };
 
 /*
-    Enqueue may require rehashing, changing the queue's pointer
-    The new address is returned along with the enqueue result (success/failure)
+    Iterator counterpart that lives on the caller's stack, for HashQueues only.
+    Its functions are static inline below, so a traversal costs no allocation and no indirect call.
+*/
+struct HashQueueCursor {
+    Entry *current;
+};
 
-    The rehash procedure will also return a QueueResultPair
+/*
+    Enqueue returns the queue's address along with the enqueue result (success/failure)
+    HashQueue rehashing only reallocates the table, so the address never changes
+    and callers may keep holding their original queue pointer
 */
 struct QueueResultPair {
-    ThreadQueue *queue;             // in case of rehashing, new memory
+    ThreadQueue *queue;             // always the queue enqueued onto
     int result;                     // success/failure value
 };
 
@@ -65,6 +175,8 @@ struct ThreadQueue {
     Iterator* (*iterator)(ThreadQueue*);                   // Constructs an iterator over the ThreadQueue
     int (*size) (ThreadQueue*);                            // Returns the number of elements in the ThreadQueue
     void (*freeQueue) (ThreadQueue*);
+    QueueResultPair (*enqueueBatch) (Thread**, int, ThreadQueue*);  // Inputs: elements, count, queue. Output: queue pointer, number enqueued
+    int (*dequeueN) (Thread**, int, ThreadQueue*);                  // Inputs: output array, max count, queue. Output: number dequeued, oldest first
 };
 
 
@@ -79,6 +191,8 @@ struct HashQueue {
     Iterator* (*iterator)(ThreadQueue*);
     int (*size) (ThreadQueue*);                            // Returns the number of elements in the HashQueue
     void (*freeQueue) (ThreadQueue*);
+    QueueResultPair (*enqueueBatch) (Thread**, int, ThreadQueue*);  // Inputs: elements, count, queue. Output: queue pointer, number enqueued
+    int (*dequeueN) (Thread**, int, ThreadQueue*);                  // Inputs: output array, max count, queue. Output: number dequeued, oldest first
 
     // Hash Queue only
     u32 (*getHash) (u16);
@@ -87,20 +201,136 @@ struct HashQueue {
     Entry* (*getEntryByID) (u16, ThreadQueue*);
     int _size;
     int capacity;                                          // must be a power of 2
-    double load_factor;                                    // [0,1]
+    double max_load;                                       // table doubles when the load factor exceeds this, (0,1)
+    double shrink_threshold;                               // table halves when the load factor drops below this, 0 disables shrinking
+    int grow_at;                                           // _size limits derived from the thresholds, updated on resize
+    int shrink_at;
+    int min_capacity;                                      // table never shrinks below this, the sized or reserved capacity
     Entry *head;
     Entry *tail;
     Entry **table;                                        // malloc table, uses double pointers to allow rehashing to maintain next and prev pointers
-      
+    Slot *slots;                                          // ids and probe distances, parallel to table
+    EntryPool pool;                                       // Entry storage, untouched by rehash
+
+    // Incremental rehashing
+    /*
+        If incremental_rehash is set, growth costs every operation a bounded amount of work instead of stalling one:
+        - the doubled table is allocated uninitialised, and REHASH_PREPARE_STEP of its slots are initialised per operation
+        - once ready it becomes the live table, and REHASH_MIGRATE_STEP Entries per operation move over from old_table
+        enqueueBatch, HashQueue_rehash, HashQueue_reserve and shrinking remain eager, finishing any pending growth first.
+    */
+    int incremental_rehash;
+    Entry **next_table;                                    // doubled table being initialised, NULL when no growth is pending
+    Slot *next_slots;
+    int next_prepared;                                     // next_table slots initialised so far
+    Entry **old_table;                                     // table being migrated away from, NULL when no migration is in progress
+    Slot *old_slots;
+    int old_capacity;
+    u32 migrate_index;                                     // next old_table slot to migrate
+
+    // Cross-CPU wakeups
+    _Atomic(Thread*) inbox;                                // Threads posted by other CPUs, newest first, linked through wake_next
+
+    // Optimistic readers
+    _Atomic u32 seq;                                       // odd while the table is being modified
+    _Atomic int readers;                                   // lookups in progress on other CPUs
+    int write_depth;
+    RetiredTable *retired;                                 // replaced tables awaiting readers == 0
+
+#ifdef HASHQUEUE_STATS
+    HashQueueStats stats;
+#endif
+};
+
+/*
+    A table replaced while other CPUs may still be probing it
+*/
+struct RetiredTable {
+    RetiredTable *next;
+    Entry **table;
+    Slot *slots;
 };
 
 HashQueue *new_HashQueue();
 int init_HashQueue(HashQueue*);
-QueueResultPair HashQueue_rehash(HashQueue*); 
+HashQueue *new_HashQueue_with(int capacity_hint, double max_load);
+int init_HashQueue_with(HashQueue*, int capacity_hint, double max_load);
+int HashQueue_reserve(int n, HashQueue*);
+double HashQueue_loadFactor(HashQueue*);
+void HashQueue_setShrinkThreshold(double, HashQueue*);
+int HashQueue_rehash(HashQueue*);
+int HashQueue_shrink(HashQueue*);
+QueueResultPair HashQueue_enqueue(Thread*, ThreadQueue*);   // vtable implementations, called directly by hash-queue-inline.h
+Thread *HashQueue_dequeue(ThreadQueue*);
+Thread *HashQueue_removeByID(u16, ThreadQueue*);
+void HashQueue_post(Thread*, HashQueue*);
+int HashQueue_drainInbox(HashQueue*);
+Thread *HashQueue_removeTail(HashQueue*);
+QueueResultPair ThreadQueue_enqueueEach(Thread**, int, ThreadQueue*);
+int ThreadQueue_dequeueEach(Thread**, int, ThreadQueue*);
+int HashQueue_removeByIDs(const u32 *ids, HashQueue*);
+int HashQueue_removeIf(int (*predicate) (Thread*, void*), void *ctx, HashQueue*);
+Thread *HashQueue_readGetByID(u16, HashQueue*);
+int HashQueue_readContains(u16, HashQueue*);
+HashQueueStats HashQueue_getStats(HashQueue*);
+void HashQueue_resetStats(HashQueue*);
+void HashQueue_dumpStats(HashQueue*);
+
+// Entry Pool
+
+int init_EntryPool(EntryPool*);
+Entry *EntryPool_alloc(EntryPool*);
+void EntryPool_release(Entry*, EntryPool*);
+void EntryPool_free(EntryPool*);
+
+// Stack Iteration
+
+/*
+    FIFO traversal, oldest first. The queue must not be modified while traversing.
+*/
+static inline void init_HashQueueCursor(HashQueueCursor *cursor, HashQueue *hashqueue) {
+    cursor -> current = hashqueue -> head;
+}
+
+static inline int HashQueueCursor_hasNext(HashQueueCursor *cursor) {
+    return cursor -> current != NULL;
+}
+
+static inline Thread *HashQueueCursor_next(HashQueueCursor *cursor) {
+    Entry *curr = cursor -> current;
+    cursor -> current = curr -> next;
+    return curr -> t;
+}
+
+/*
+    - entry: Entry* loop cursor, as list_for_each is to list_head
+*/
+#define hashqueue_for_each_entry(entry, hashqueue) \
+    for (entry = (hashqueue) -> head; entry != NULL; entry = entry -> next)
+
+/*
+    - entry: Entry* loop cursor, n: Entry* holding the next one, as list_for_each_safe is to list_head
+    - entry may be removed (e.g. by removeByID) during the walk, n must not be
+*/
+#define hashqueue_for_each_entry_safe(entry, n, hashqueue)                 \
+    for (entry = (hashqueue) -> head, n = (entry == NULL) ? NULL : entry -> next; \
+         entry != NULL;                                                     \
+         entry = n, n = (entry == NULL) ? NULL : entry -> next)
+
+/*
+    - pos: Thread* loop cursor, as list_for_each_entry is to list_head
+*/
+#define hashqueue_for_each(pos, hashqueue)                                   \
+    for (Entry *hq_entry_##pos = (hashqueue) -> head;                       \
+         hq_entry_##pos != NULL && ((pos) = hq_entry_##pos -> t, 1);        \
+         hq_entry_##pos = hq_entry_##pos -> next)
 
 // Hash Functions
 
 u32 IDHash(u16 data);
 u32 FNV1AHash(u16 data);
+u32 FibonacciHash(u16 data);
+u32 MurmurHash(u16 data);
+u32 XorShiftHash(u16 data);
 
 #endif /* HASH_QUEUE_H */
\ No newline at end of file
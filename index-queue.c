@@ -0,0 +1,398 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "index-queue.h"
+
+//------------------------------ Entry Array ------------------------------------------------
+
+/*
+    - Doubles the entry and thread arrays, capped at MAX_THREADS
+    Returns 0 if the queue is already at MAX_THREADS or realloc failed, 1 otherwise.
+*/
+static int IndexQueue_growEntries(IndexQueue *indexqueue) {
+    if (indexqueue -> entry_capacity >= MAX_THREADS) {
+        return 0;
+    }
+
+    const int new_capacity = indexqueue -> entry_capacity * 2;
+
+    IndexEntry *entries = realloc(indexqueue -> entries, new_capacity * sizeof(IndexEntry));
+    if (entries == NULL) {
+        return 0;
+    }
+    indexqueue -> entries = entries;
+
+    Thread **threads = realloc(indexqueue -> threads, new_capacity * sizeof(Thread*));
+    if (threads == NULL) {
+        return 0;
+    }
+    indexqueue -> threads = threads;
+
+    indexqueue -> entry_capacity = new_capacity;
+    return 1;
+}
+
+/*
+    - Returns the index of an unused IndexEntry, or -1 if none could be allocated
+    - Released entries are reused before fresh ones are handed out
+*/
+static int IndexQueue_allocEntry(IndexQueue *indexqueue) {
+    if (indexqueue -> free_count > 0) {
+        const u16 index = indexqueue -> free_head;
+        indexqueue -> free_head = indexqueue -> entries[index].next;
+        -- indexqueue -> free_count;
+        return index;
+    }
+
+    if (indexqueue -> entries_used == indexqueue -> entry_capacity && IndexQueue_growEntries(indexqueue) == 0) {
+        return -1;
+    }
+    return indexqueue -> entries_used ++;
+}
+
+static void IndexQueue_releaseEntry(u16 index, IndexQueue *indexqueue) {
+    indexqueue -> entries[index].next = indexqueue -> free_head;
+    indexqueue -> threads[index] = NULL;
+    indexqueue -> free_head = index;
+    ++ indexqueue -> free_count;
+}
+
+//------------------------------ IndexQueue ADT IMPLEMENTATIONS -----------------------------
+
+/*
+    Robin Hood insertion, as HashQueue_place, over u16 entry indices
+*/
+static void IndexQueue_place(u16 index, u16 *table, Slot *slots, int capacity, IndexQueue *indexqueue) {
+    const u32 table_mask = capacity - 1;
+    u16 thread_id = indexqueue -> threads[index] -> id;
+    u32 table_index = indexqueue -> getHash(thread_id) & table_mask;
+    u16 probe_distance = 0;
+
+    while (slots[table_index].probe_distance != SLOT_EMPTY)
+    {
+        if (slots[table_index].probe_distance < probe_distance) {
+            const u16 occupant = table[table_index];
+            const Slot displaced = slots[table_index];
+
+            table[table_index] = index;
+            slots[table_index].id = thread_id;
+            slots[table_index].probe_distance = probe_distance;
+            indexqueue -> entries[index].table_index = table_index;
+
+            index = occupant;                                   // continue by placing the displaced occupant
+            thread_id = displaced.id;
+            probe_distance = displaced.probe_distance;
+        }
+        table_index = (table_index + 1) & table_mask;
+        ++ probe_distance;
+    }
+
+    table[table_index] = index;
+    slots[table_index].id = thread_id;
+    slots[table_index].probe_distance = probe_distance;
+    indexqueue -> entries[index].table_index = table_index;
+}
+
+/*
+    - Probes slots for thread_id, returning its table index or -1 if not found
+*/
+static int IndexQueue_findSlot(u16 thread_id, IndexQueue *indexqueue) {
+    const u32 table_mask = indexqueue -> capacity - 1;
+    const Slot *slots = indexqueue -> slots;
+    u32 table_index = indexqueue -> getHash(thread_id) & table_mask;
+    u16 probe_distance = 0;
+
+    while (slots[table_index].probe_distance != SLOT_EMPTY && slots[table_index].probe_distance >= probe_distance)
+    {
+        if (slots[table_index].id == thread_id) {
+            return (int) table_index;
+        }
+        table_index = (table_index + 1) & table_mask;
+        ++ probe_distance;
+    }
+    return -1;
+}
+
+/*
+    Backward shift deletion, as HashQueue_tableRepair
+*/
+static void IndexQueue_tableRepair(u32 empty_index, IndexQueue *indexqueue) {
+    const u32 table_mask = indexqueue -> capacity - 1;
+    u16 *table = indexqueue -> table;
+    Slot *slots = indexqueue -> slots;
+    u32 inspect_index = (empty_index + 1) & table_mask;
+
+    while (slots[inspect_index].probe_distance != SLOT_EMPTY && slots[inspect_index].probe_distance > 0) {
+        table[empty_index] = table[inspect_index];
+        indexqueue -> entries[table[empty_index]].table_index = empty_index;
+        slots[empty_index].id = slots[inspect_index].id;
+        slots[empty_index].probe_distance = slots[inspect_index].probe_distance - 1;
+
+        slots[inspect_index].probe_distance = SLOT_EMPTY;
+
+        empty_index = inspect_index;
+        inspect_index = (inspect_index + 1) & table_mask;
+    }
+}
+
+/*
+    - Allocates a table and its slots array, with every slot empty
+    Returns 0 if any malloc failed, 1 otherwise.
+*/
+static int IndexQueue_allocTable(int capacity, u16 **table, Slot **slots) {
+    *table = malloc(capacity * sizeof(u16));
+    *slots = malloc(capacity * sizeof(Slot));
+
+    if (*table == NULL || *slots == NULL) {
+        free(*table);
+        free(*slots);
+        return 0;
+    }
+
+    for (int i = 0; i < capacity; ++i) {
+        (*slots)[i].id = 0;
+        (*slots)[i].probe_distance = SLOT_EMPTY;
+    }
+    return 1;
+}
+
+/*
+    - Doubles the table, placing entries in FIFO order
+    Returns 0 if malloc failed, leaving the queue untouched, 1 otherwise.
+*/
+static int IndexQueue_rehash(IndexQueue *indexqueue) {
+    const int new_capacity = indexqueue -> capacity * 2;
+    u16 *new_table;
+    Slot *new_slots;
+
+    if (IndexQueue_allocTable(new_capacity, &new_table, &new_slots) == 0) {
+        return 0;
+    }
+
+    u16 curr = indexqueue -> head;
+    for (int i = 0; i < indexqueue -> _size; ++i) {
+        IndexQueue_place(curr, new_table, new_slots, new_capacity, indexqueue);
+        curr = indexqueue -> entries[curr].next;
+    }
+
+    free(indexqueue -> table);
+    free(indexqueue -> slots);
+    indexqueue -> table = new_table;
+    indexqueue -> slots = new_slots;
+    indexqueue -> capacity = new_capacity;
+    indexqueue -> grow_at = (int) (new_capacity * REHASH_THRESHOLD);
+    return 1;
+}
+
+/*
+    Returns 0 if enqueue failed (MAX_THREADS reached or allocation failure), 1 if succeeded.
+    As in HashQueue_enqueue, 1 means t is queued: a rehash failing after the node is linked is only
+    reported, and the next enqueue tries again. Once failed rehashes leave the table one slot from full,
+    enqueue rehashes before placing, and returns 0 if it still can't.
+    The queue never moves, so the returned queue is always the one passed in.
+*/
+static QueueResultPair IndexQueue_enqueue(Thread *t, ThreadQueue *queue) {
+    IndexQueue *indexqueue = (IndexQueue*) queue;
+    QueueResultPair result = {queue, 0};
+
+    if (indexqueue -> _size >= indexqueue -> capacity - 1 && IndexQueue_rehash(indexqueue) == 0) {
+        printf("Table memory allocation failed.\n");
+        return result;
+    }
+
+    const int new_index = IndexQueue_allocEntry(indexqueue);
+    if (new_index < 0) {
+        printf("Entry memory allocation failed.\n");
+        return result;
+    }
+
+    IndexEntry *entries = indexqueue -> entries;
+    IndexEntry *new_entry = &(entries[new_index]);
+    indexqueue -> threads[new_index] = t;
+
+    if (indexqueue -> _size == 0) {
+        new_entry -> prev = new_index;
+        new_entry -> next = new_index;
+        indexqueue -> head = new_index;
+    } else {
+        const u16 head = indexqueue -> head;
+        const u16 tail = entries[head].prev;
+        new_entry -> prev = tail;
+        new_entry -> next = head;
+        entries[tail].next = new_index;
+        entries[head].prev = new_index;
+    }
+
+    IndexQueue_place(new_index, indexqueue -> table, indexqueue -> slots, indexqueue -> capacity, indexqueue);
+    ++ indexqueue -> _size;
+
+    if (indexqueue -> _size > indexqueue -> grow_at && IndexQueue_rehash(indexqueue) == 0) {
+        printf("Table memory allocation failed.\n");
+    }
+
+    result.result = 1;
+    return result;
+}
+
+/*
+    - Unlinks an IndexEntry from the FIFO and the table, returning its Thread
+*/
+static Thread *IndexQueue_removeEntry(u16 index, IndexQueue *indexqueue) {
+    IndexEntry *entries = indexqueue -> entries;
+    const u16 prev = entries[index].prev;
+    const u16 next = entries[index].next;
+
+    entries[prev].next = next;          // no-ops when index is the only entry
+    entries[next].prev = prev;
+    if (indexqueue -> head == index) {
+        indexqueue -> head = next;
+    }
+
+    const u32 table_index = entries[index].table_index;
+    indexqueue -> slots[table_index].probe_distance = SLOT_EMPTY;
+    IndexQueue_tableRepair(table_index, indexqueue);
+    -- indexqueue -> _size;
+
+    Thread *t = indexqueue -> threads[index];
+    IndexQueue_releaseEntry(index, indexqueue);
+    return t;
+}
+
+static Thread *IndexQueue_dequeue(ThreadQueue *queue) {
+    IndexQueue *indexqueue = (IndexQueue*) queue;
+
+    if (indexqueue -> _size == 0) {
+        return NULL;
+    }
+
+    return IndexQueue_removeEntry(indexqueue -> head, indexqueue);
+}
+
+static Thread *IndexQueue_removeByID(u16 thread_id, ThreadQueue *queue) {
+    IndexQueue *indexqueue = (IndexQueue*) queue;
+    const int table_index = IndexQueue_findSlot(thread_id, indexqueue);
+
+    if (table_index == -1) {
+        return NULL;
+    }
+
+    return IndexQueue_removeEntry(indexqueue -> table[table_index], indexqueue);
+}
+
+static Thread *IndexQueue_getByID(u16 thread_id, ThreadQueue *queue) {
+    IndexQueue *indexqueue = (IndexQueue*) queue;
+    const int table_index = IndexQueue_findSlot(thread_id, indexqueue);
+    return (table_index == -1) ? NULL : indexqueue -> threads[indexqueue -> table[table_index]];
+}
+
+static int IndexQueue_contains(u16 thread_id, ThreadQueue *queue) {
+    IndexQueue *indexqueue = (IndexQueue*) queue;
+    return (IndexQueue_findSlot(thread_id, indexqueue) != -1);
+}
+
+static int IndexQueue_isEmpty(ThreadQueue *queue) {
+    IndexQueue *indexqueue = (IndexQueue*) queue;
+    return (indexqueue -> _size == 0);
+}
+
+static int IndexQueue_size(ThreadQueue *queue) {
+    IndexQueue *indexqueue = (IndexQueue*) queue;
+    return indexqueue -> _size;
+}
+
+//----------------------------------- ITERATOR FUNCTIONS  -----------------------------------------
+
+static Thread *IndexIterator_next(Iterator *iterator) {
+    IndexQueue *indexqueue = (IndexQueue*) iterator -> queue;
+    const u16 curr = iterator -> currentIndex;
+    iterator -> currentIndex = indexqueue -> entries[curr].next;
+    -- iterator -> remaining;
+    return indexqueue -> threads[curr];
+}
+
+static int IndexIterator_hasNext(Iterator *iterator) {
+    return iterator -> remaining > 0;
+}
+
+static Iterator *new_IndexIterator(ThreadQueue *queue) {
+    IndexQueue *indexqueue = (IndexQueue*) queue;
+    Iterator *iterator = malloc(sizeof(Iterator));
+    if (iterator == NULL) {
+        return NULL;
+    }
+
+    iterator -> hasNext = IndexIterator_hasNext;
+    iterator -> next = IndexIterator_next;
+    iterator -> currentEntry = NULL;
+    iterator -> queue = queue;
+    iterator -> currentIndex = indexqueue -> head;
+    iterator -> remaining = indexqueue -> _size;
+
+    return iterator;
+}
+
+//----------------------------------- CONSTRUCTORS + DESTRUCTOR -----------------------------------
+
+static void IndexQueue_free(ThreadQueue *queue) {
+    IndexQueue *indexqueue = (IndexQueue*) queue;
+    free(indexqueue -> entries);
+    free(indexqueue -> threads);
+    free(indexqueue -> table);
+    free(indexqueue -> slots);
+    free(indexqueue);
+}
+
+/*
+    Returns 0 if any malloc failed, 1 otherwise.
+*/
+int init_IndexQueue(IndexQueue *this) {
+    this -> getHash = FNV1AHash;
+    this -> _size = 0;
+    this -> capacity = INITIAL_CAPACITY;
+    this -> grow_at = (int) (INITIAL_CAPACITY * REHASH_THRESHOLD);
+    this -> head = 0;
+    this -> free_head = 0;
+    this -> free_count = 0;
+    this -> entries_used = 0;
+    this -> entry_capacity = INDEX_INITIAL_ENTRIES;
+    this -> entries = malloc(INDEX_INITIAL_ENTRIES * sizeof(IndexEntry));
+    this -> threads = malloc(INDEX_INITIAL_ENTRIES * sizeof(Thread*));
+
+    if (this -> entries == NULL || this -> threads == NULL) {
+        free(this -> entries);
+        free(this -> threads);
+        return 0;
+    }
+
+    if (IndexQueue_allocTable(INITIAL_CAPACITY, &(this -> table), &(this -> slots)) == 0) {
+        free(this -> entries);
+        free(this -> threads);
+        return 0;
+    }
+
+    this -> dequeue = IndexQueue_dequeue;
+    this -> contains = IndexQueue_contains;
+    this -> enqueue = IndexQueue_enqueue;
+    this -> isEmpty = IndexQueue_isEmpty;
+    this -> removeByID = IndexQueue_removeByID;
+    this -> getByID = IndexQueue_getByID;
+    this -> iterator = new_IndexIterator;
+    this -> size = IndexQueue_size;
+    this -> freeQueue = IndexQueue_free;
+    this -> enqueueBatch = ThreadQueue_enqueueEach;
+    this -> dequeueN = ThreadQueue_dequeueEach;
+
+    return 1;
+}
+
+IndexQueue *new_IndexQueue() {
+    IndexQueue *this = malloc(sizeof(IndexQueue));
+    if (this == NULL) {
+        return NULL;
+    }
+    if (init_IndexQueue(this) == 0) {
+        free(this);
+        return NULL;
+    }
+    return this;
+}
@@ -0,0 +1,63 @@
+#ifndef INDEX_QUEUE_H
+#define INDEX_QUEUE_H
+
+#include "hash-queue.h"
+
+#define INDEX_INITIAL_ENTRIES 64                           // IndexEntry slots allocated up front, doubled on demand up to MAX_THREADS
+
+typedef struct IndexEntry IndexEntry;
+typedef struct IndexQueue IndexQueue;
+
+/*
+    FIFO node of an IndexQueue, 8 bytes instead of the 32 of an Entry.
+    A queue never holds more than MAX_THREADS Entries, so links are u16 indices into the entry array.
+*/
+struct IndexEntry {
+    u16 prev;
+    u16 next;
+    u32 table_index;    // allows dequeuing without search
+};
+
+/*
+    HashQueue backend with index linked Entries:
+    - IndexEntries live in one growable array, so the FIFO of thousands of threads spans a few cache lines
+    - the FIFO is circular (head's prev is the tail), so no index has to be reserved as a NULL link
+    - Thread pointers are kept in a parallel array, touched only when a Thread is returned
+    - the table holds u16 entry indices next to a Slot array, probed Robin Hood style as in HashQueue
+
+    Growing the entry array moves it, but indices stay valid, so nothing needs relinking.
+*/
+struct IndexQueue {
+    // Common Queue Interface
+    Thread* (*dequeue) (ThreadQueue*);                     // Input: queue. Output: dequeued element
+    int (*contains) (u16, ThreadQueue*);                   // success/failure return value
+    QueueResultPair (*enqueue) (Thread*, ThreadQueue*);    // Inputs: enqueue element, queue. Output: queue pointer, enqueue success/failure
+    int (*isEmpty) (ThreadQueue*);                         // success/failure return value
+    Thread* (*removeByID) (u16, ThreadQueue*);             // Inputs: ID, queue. Output: removed element
+    Thread* (*getByID) (u16, ThreadQueue*);                // Returns a reference to the Thread, but does not remove
+    Iterator* (*iterator)(ThreadQueue*);
+    int (*size) (ThreadQueue*);                            // Returns the number of elements in the IndexQueue
+    void (*freeQueue) (ThreadQueue*);
+    QueueResultPair (*enqueueBatch) (Thread**, int, ThreadQueue*);  // Inputs: elements, count, queue. Output: queue pointer, number enqueued
+    int (*dequeueN) (Thread**, int, ThreadQueue*);                  // Inputs: output array, max count, queue. Output: number dequeued, oldest first
+
+    // Index Queue only
+    u32 (*getHash) (u16);
+    int _size;
+    int capacity;                                          // table slots, must be a power of 2
+    int grow_at;                                           // _size past which the table doubles, capacity * REHASH_THRESHOLD
+    u16 head;                                              // only meaningful while _size > 0
+    u16 free_head;                                         // released IndexEntries, linked through next
+    int free_count;
+    int entries_used;                                      // IndexEntries handed out at least once
+    int entry_capacity;                                    // at most MAX_THREADS
+    IndexEntry *entries;
+    Thread **threads;                                      // parallel to entries
+    u16 *table;                                            // entry index of each occupied slot
+    Slot *slots;                                           // ids and probe distances, parallel to table
+};
+
+IndexQueue *new_IndexQueue();
+int init_IndexQueue(IndexQueue*);
+
+#endif /* INDEX_QUEUE_H */
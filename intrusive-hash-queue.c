@@ -0,0 +1,259 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "intrusive-hash-queue.h"
+
+#define thread_of(node) list_entry(node, Thread, thread_list)
+
+//------------------------------ IntrusiveHashQueue ADT IMPLEMENTATIONS ---------------------
+
+/*
+    Returns 0 if enqueue failed, 1 if succeeded.
+    No allocation takes place unless the table needs to grow.
+*/
+static QueueResultPair IntrusiveHashQueue_enqueue(Thread *t, ThreadQueue *queue) {
+    IntrusiveHashQueue *hashqueue = (IntrusiveHashQueue*) queue;
+    const u32 table_mask = (hashqueue -> capacity) - 1;
+    u32 table_index = hashqueue -> getHash(t -> id) & table_mask;
+
+    while (hashqueue -> table[table_index] != NULL) // iterate while positions unavailable
+    {
+        table_index = (table_index + 1) & table_mask;
+    }
+
+    t -> queue_index = table_index;
+    hashqueue -> table[table_index] = t;
+    list_add_tail(&(t -> thread_list), &(hashqueue -> fifo));
+    ++ hashqueue -> _size;
+
+    hashqueue -> load_factor = (double) hashqueue -> _size / hashqueue -> capacity;
+    QueueResultPair result = {queue, 1};
+
+    // Check if rehashing required
+    if (hashqueue -> load_factor > REHASH_THRESHOLD) {
+        result.result = IntrusiveHashQueue_rehash(hashqueue);
+    }
+
+    return result;
+}
+
+/*
+    Same repair procedure as HashQueue_tableRepair, moving Thread pointers instead of Entries
+*/
+static void IntrusiveHashQueue_tableRepair(u32 empty_index, IntrusiveHashQueue *hashqueue) {
+    const u32 table_mask = (hashqueue -> capacity) - 1;
+    u32 inspect_index = (empty_index + 1) & table_mask;
+    u32 ideal_index;
+
+    while (hashqueue -> table[inspect_index] != NULL) {
+        ideal_index = hashqueue -> getHash(hashqueue -> table[inspect_index] -> id) & table_mask;
+
+        if (!(ideal_index == inspect_index ||
+            (empty_index < ideal_index && ideal_index < inspect_index) ||
+            (ideal_index < inspect_index && inspect_index < empty_index) ||
+            (inspect_index < empty_index && empty_index < ideal_index)))
+        {
+            hashqueue -> table[empty_index] = hashqueue -> table[inspect_index];
+            hashqueue -> table[empty_index] -> queue_index = empty_index;
+            hashqueue -> table[inspect_index] = NULL;
+
+            empty_index = inspect_index;
+        }
+
+        inspect_index = (inspect_index + 1) & table_mask;
+    }
+}
+
+/*
+    - Unlinks a Thread from both the FIFO and the table
+*/
+static void IntrusiveHashQueue_unlink(Thread *t, IntrusiveHashQueue *hashqueue) {
+    const u32 table_index = t -> queue_index;
+
+    list_del_init(&(t -> thread_list));
+    hashqueue -> table[table_index] = NULL;
+    -- hashqueue -> _size;
+    hashqueue -> load_factor = (double) hashqueue -> _size / hashqueue -> capacity;
+
+    IntrusiveHashQueue_tableRepair(table_index, hashqueue);
+}
+
+static Thread *IntrusiveHashQueue_dequeue(ThreadQueue *queue) {
+    IntrusiveHashQueue *hashqueue = (IntrusiveHashQueue*) queue;
+
+    if (list_empty(&(hashqueue -> fifo))) {
+        return NULL;
+    }
+
+    Thread *t = thread_of(hashqueue -> fifo.next);
+    IntrusiveHashQueue_unlink(t, hashqueue);
+    return t;
+}
+
+/*
+    - Probes the table for a Thread, returning its slot, or -1 if not found
+*/
+static int IntrusiveHashQueue_getTableIndexByID(u16 thread_id, ThreadQueue *queue) {
+    IntrusiveHashQueue *hashqueue = (IntrusiveHashQueue*) queue;
+    const u32 table_mask = (hashqueue -> capacity) - 1;
+    u32 table_index = hashqueue -> getHash(thread_id) & table_mask;
+
+    while (hashqueue -> table[table_index] != NULL)
+    {
+        if (hashqueue -> table[table_index] -> id == thread_id) {
+            return (int) table_index;
+        } else {
+            table_index = (table_index + 1) & table_mask;
+        }
+    }
+    return -1;
+}
+
+static Thread *IntrusiveHashQueue_removeByID(u16 thread_id, ThreadQueue *queue) {
+    IntrusiveHashQueue *hashqueue = (IntrusiveHashQueue*) queue;
+    const int table_index = IntrusiveHashQueue_getTableIndexByID(thread_id, queue);
+
+    if (table_index == -1) {
+        return NULL;
+    }
+
+    Thread *found = hashqueue -> table[table_index];
+    IntrusiveHashQueue_unlink(found, hashqueue);
+    return found;
+}
+
+static Thread *IntrusiveHashQueue_getByID(u16 thread_id, ThreadQueue *queue) {
+    IntrusiveHashQueue *hashqueue = (IntrusiveHashQueue*) queue;
+    const int table_index = IntrusiveHashQueue_getTableIndexByID(thread_id, queue);
+    return (table_index == -1) ? NULL : hashqueue -> table[table_index];
+}
+
+static int IntrusiveHashQueue_contains(u16 thread_id, ThreadQueue *queue) {
+    return (IntrusiveHashQueue_getTableIndexByID(thread_id, queue) != -1);
+}
+
+static int IntrusiveHashQueue_isEmpty(ThreadQueue *queue) {
+    IntrusiveHashQueue *hashqueue = (IntrusiveHashQueue*) queue;
+    return (hashqueue -> _size == 0);
+}
+
+static int IntrusiveHashQueue_size(ThreadQueue *queue) {
+    IntrusiveHashQueue *hashqueue = (IntrusiveHashQueue*) queue;
+    return hashqueue -> _size;
+}
+
+//----------------------------------- ITERATOR FUNCTIONS  -----------------------------------------
+
+static Thread *IntrusiveIterator_next(Iterator *iterator) {
+    struct list_head *curr = iterator -> currentNode;
+    iterator -> currentNode = curr -> next;
+    return thread_of(curr);
+}
+
+static int IntrusiveIterator_hasNext(Iterator *iterator) {
+    return iterator -> currentNode != iterator -> listHead;
+}
+
+static Iterator *new_IntrusiveIterator(ThreadQueue *queue) {
+    IntrusiveHashQueue *hashqueue = (IntrusiveHashQueue*) queue;
+    Iterator *iterator = malloc(sizeof(Iterator));
+    if (iterator == NULL) {
+        return NULL;
+    }
+
+    iterator -> hasNext = IntrusiveIterator_hasNext;
+    iterator -> next = IntrusiveIterator_next;
+    iterator -> currentEntry = NULL;
+    iterator -> queue = queue;
+    iterator -> remaining = 0;
+    iterator -> currentNode = hashqueue -> fifo.next;
+    iterator -> listHead = &(hashqueue -> fifo);
+
+    return iterator;
+}
+
+//----------------------------------- CONSTRUCTORS + DESTRUCTOR -----------------------------------
+
+/*
+    - The queue owns no Threads, so only the table and struct are freed
+*/
+static void IntrusiveHashQueue_free(ThreadQueue *queue) {
+    IntrusiveHashQueue *hashqueue = (IntrusiveHashQueue*) queue;
+    free(hashqueue -> table);
+    free(hashqueue);
+}
+
+/*
+    Returns 0 if any malloc failed, 1 otherwise.
+*/
+int init_IntrusiveHashQueue(IntrusiveHashQueue *this) {
+    this -> _size = 0;
+    this -> capacity = INITIAL_CAPACITY;
+    this -> load_factor = 0.0;
+    INIT_LIST_HEAD(&(this -> fifo));
+    this -> table = calloc(INITIAL_CAPACITY, sizeof(Thread*));
+    if (this -> table == NULL) {
+        return 0;
+    }
+
+    this -> dequeue = IntrusiveHashQueue_dequeue;
+    this -> contains = IntrusiveHashQueue_contains;
+    this -> enqueue = IntrusiveHashQueue_enqueue;
+    this -> isEmpty = IntrusiveHashQueue_isEmpty;
+    this -> removeByID = IntrusiveHashQueue_removeByID;
+    this -> getByID = IntrusiveHashQueue_getByID;
+    this -> iterator = new_IntrusiveIterator;
+    this -> size = IntrusiveHashQueue_size;
+    this -> freeQueue = IntrusiveHashQueue_free;
+    this -> enqueueBatch = ThreadQueue_enqueueEach;
+    this -> dequeueN = ThreadQueue_dequeueEach;
+    this -> getHash = FNV1AHash;
+    this -> getTableIndexByID = IntrusiveHashQueue_getTableIndexByID;
+
+    return 1;
+}
+
+IntrusiveHashQueue *new_IntrusiveHashQueue() {
+    IntrusiveHashQueue *this = malloc(sizeof(IntrusiveHashQueue));
+    if (this == NULL) {
+        return NULL;
+    }
+    if (init_IntrusiveHashQueue(this) == 0) {
+        free(this);
+        return NULL;
+    }
+    return this;
+}
+
+/*
+    - Doubles the table, reinserting Threads in FIFO order
+    - Only the table is replaced: the Threads' list_heads point at the fifo field,
+      so the queue itself must never move
+    Returns 0 if the new table could not be allocated (the old table is kept), 1 otherwise.
+*/
+int IntrusiveHashQueue_rehash(IntrusiveHashQueue *hashqueue) {
+    const int new_capacity = (hashqueue -> capacity) * 2;
+    Thread **new_table = calloc(new_capacity, sizeof(Thread*));
+    if (new_table == NULL) {
+        return 0;
+    }
+
+    const u32 table_mask = new_capacity - 1;
+    u32 table_index;
+    Thread *t;
+
+    list_for_each_entry(t, &(hashqueue -> fifo), thread_list) {
+        table_index = hashqueue -> getHash(t -> id) & table_mask;
+        while (new_table[table_index] != NULL) {
+            table_index = (table_index + 1) & table_mask;
+        }
+        new_table[table_index] = t;
+        t -> queue_index = table_index;
+    }
+
+    free(hashqueue -> table);
+    hashqueue -> table = new_table;
+    hashqueue -> capacity = new_capacity;
+    hashqueue -> load_factor = (double) hashqueue -> _size / new_capacity;
+    return 1;
+}
@@ -0,0 +1,45 @@
+#ifndef INTRUSIVE_HASH_QUEUE_H
+#define INTRUSIVE_HASH_QUEUE_H
+
+#include "hash-queue.h"
+
+typedef struct IntrusiveHashQueue IntrusiveHashQueue;
+
+/*
+    HashQueue variant which stores no Entries of its own:
+    - the FIFO is chained through each Thread's thread_list (list.h)
+    - the table holds Thread pointers, and each Thread records its own slot in queue_index
+
+    A Thread may only be linked into one IntrusiveHashQueue at a time,
+    so duplicate IDs are not supported.
+*/
+struct IntrusiveHashQueue {
+    // Common Queue Interface
+    Thread* (*dequeue) (ThreadQueue*);                     // Input: queue. Output: dequeued element
+    int (*contains) (u16, ThreadQueue*);                   // success/failure return value
+    QueueResultPair (*enqueue) (Thread*, ThreadQueue*);    // Inputs: enqueue element, queue. Output: queue pointer, enqueue success/failure
+    int (*isEmpty) (ThreadQueue*);                         // success/failure return value
+    Thread* (*removeByID) (u16, ThreadQueue*);             // Inputs: ID, queue. Output: removed element
+    Thread* (*getByID) (u16, ThreadQueue*);                // Returns a reference to the Thread, but does not remove
+    Iterator* (*iterator)(ThreadQueue*);
+    int (*size) (ThreadQueue*);                            // Returns the number of elements in the IntrusiveHashQueue
+    void (*freeQueue) (ThreadQueue*);
+    QueueResultPair (*enqueueBatch) (Thread**, int, ThreadQueue*);  // Inputs: elements, count, queue. Output: queue pointer, number enqueued
+    int (*dequeueN) (Thread**, int, ThreadQueue*);                  // Inputs: output array, max count, queue. Output: number dequeued, oldest first
+
+    // Intrusive Hash Queue only
+    u32 (*getHash) (u16);
+    // DEBUG HELPER FUNCTIONS
+    int (*getTableIndexByID) (u16, ThreadQueue*);
+    int _size;
+    int capacity;                                          // must be a power of 2
+    double load_factor;                                    // [0,1]
+    struct list_head fifo;                                 // list head, Threads linked via thread_list
+    Thread **table;
+};
+
+IntrusiveHashQueue *new_IntrusiveHashQueue();
+int init_IntrusiveHashQueue(IntrusiveHashQueue*);
+int IntrusiveHashQueue_rehash(IntrusiveHashQueue*);
+
+#endif /* INTRUSIVE_HASH_QUEUE_H */
@@ -0,0 +1,225 @@
+#include <stdlib.h>
+
+#include "percpu-queue.h"
+
+//------------------------------ CPU Locks --------------------------------------------------
+
+static inline void CPURunQueue_lock(CPURunQueue *cpu) {
+    while (atomic_flag_test_and_set_explicit(&(cpu -> lock), memory_order_acquire)) {
+        // spin, critical sections are a handful of queue operations
+    }
+}
+
+static inline void CPURunQueue_unlock(CPURunQueue *cpu) {
+    atomic_store_explicit(&(cpu -> load), cpu -> queue -> _size, memory_order_relaxed);
+    atomic_flag_clear_explicit(&(cpu -> lock), memory_order_release);
+}
+
+//------------------------------ PerCPUQueues IMPLEMENTATIONS -------------------------------
+
+/*
+    Returns 0 if enqueue failed (ID already queued on some CPU, or allocation failure), 1 if succeeded.
+*/
+int PerCPU_enqueue(Thread *t, int cpu, PerCPUQueues *percpu) {
+    u8 expected = PERCPU_NO_CPU;
+
+    // claim the ID first, so two CPUs can't both queue it
+    if (!atomic_compare_exchange_strong(&(percpu -> owner[t -> id]), &expected, (u8) cpu)) {
+        return 0;
+    }
+
+    CPURunQueue *runqueue = &(percpu -> cpus[cpu]);
+    CPURunQueue_lock(runqueue);
+    const int result = runqueue -> queue -> enqueue(t, (ThreadQueue*) runqueue -> queue).result;
+    CPURunQueue_unlock(runqueue);
+
+    if (result == 0) {                                      // 0 means t was not queued, so the claim is released
+        atomic_store(&(percpu -> owner[t -> id]), PERCPU_NO_CPU);
+    }
+    return result;
+}
+
+/*
+    Steal procedure
+        - Pick the neighbour with the highest load, at least 2 so it keeps some work
+        - Take up to PERCPU_STEAL_BATCH Threads, and at most half its queue, off the victim's tail
+        - Enqueue them on the thief in their original order, then hand their IDs over in owner
+        - Any the thief can't take go back onto the victim's tail, owner never stopped naming it
+    Returns the number of Threads stolen.
+*/
+int PerCPU_steal(int cpu, PerCPUQueues *percpu) {
+    int victim = -1;
+    int victim_load = 1;
+
+    for (int i = 1; i < percpu -> cpu_count; ++i) {
+        const int candidate = (cpu + i) % percpu -> cpu_count;
+        const int load = atomic_load_explicit(&(percpu -> cpus[candidate].load), memory_order_relaxed);
+        if (load > victim_load) {
+            victim = candidate;
+            victim_load = load;
+        }
+    }
+    if (victim == -1) {
+        return 0;
+    }
+
+    Thread *batch[PERCPU_STEAL_BATCH];
+    int stolen = 0;
+
+    CPURunQueue *source = &(percpu -> cpus[victim]);
+    CPURunQueue_lock(source);
+    int batch_size = source -> queue -> _size / 2;
+    if (batch_size > PERCPU_STEAL_BATCH) {
+        batch_size = PERCPU_STEAL_BATCH;
+    }
+    while (stolen < batch_size) {
+        batch[stolen ++] = HashQueue_removeTail(source -> queue);       // newest first
+    }
+    CPURunQueue_unlock(source);
+
+    if (stolen == 0) {
+        return 0;
+    }
+
+    Thread *refused[PERCPU_STEAL_BATCH];
+    int refused_count = 0;
+
+    CPURunQueue *target = &(percpu -> cpus[cpu]);
+    CPURunQueue_lock(target);
+    for (int i = stolen - 1; i >= 0; --i) {
+        if (target -> queue -> enqueue(batch[i], (ThreadQueue*) target -> queue).result == 0) {
+            refused[refused_count ++] = batch[i];               // oldest first, as they sat on the victim
+        } else {
+            atomic_store(&(percpu -> owner[batch[i] -> id]), (u8) cpu);
+        }
+    }
+    CPURunQueue_unlock(target);
+
+    if (refused_count > 0) {
+        // the victim released Entries for these moments ago, so this fails only while memory is exhausted
+        CPURunQueue_lock(source);
+        for (int i = 0; i < refused_count; ++i) {
+            while (source -> queue -> enqueue(refused[i], (ThreadQueue*) source -> queue).result == 0) {
+                // never drop a runnable Thread
+            }
+        }
+        CPURunQueue_unlock(source);
+    }
+
+    return stolen - refused_count;
+}
+
+/*
+    - Dequeues from cpu's own queue, stealing a batch first if it is empty
+    Returns NULL only if no CPU had work to spare.
+*/
+Thread *PerCPU_dequeue(int cpu, PerCPUQueues *percpu) {
+    CPURunQueue *runqueue = &(percpu -> cpus[cpu]);
+
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        CPURunQueue_lock(runqueue);
+        Thread *t = runqueue -> queue -> dequeue((ThreadQueue*) runqueue -> queue);
+        if (t != NULL) {
+            atomic_store(&(percpu -> owner[t -> id]), PERCPU_NO_CPU);
+        }
+        CPURunQueue_unlock(runqueue);
+
+        if (t != NULL || PerCPU_steal(cpu, percpu) == 0) {
+            return t;
+        }
+    }
+    return NULL;
+}
+
+/*
+    - Removes a Thread from whichever CPU holds it
+    - owner is rechecked under the CPU's lock, if the Thread was stolen in the meantime we follow it
+*/
+Thread *PerCPU_removeByID(u16 thread_id, PerCPUQueues *percpu) {
+    u8 cpu;
+
+    while ((cpu = atomic_load(&(percpu -> owner[thread_id]))) != PERCPU_NO_CPU) {
+        CPURunQueue *runqueue = &(percpu -> cpus[cpu]);
+        CPURunQueue_lock(runqueue);
+
+        Thread *t = NULL;
+        if (atomic_load(&(percpu -> owner[thread_id])) == cpu) {
+            t = runqueue -> queue -> removeByID(thread_id, (ThreadQueue*) runqueue -> queue);
+            if (t != NULL) {
+                atomic_store(&(percpu -> owner[thread_id]), PERCPU_NO_CPU);
+            }
+        }
+        CPURunQueue_unlock(runqueue);
+
+        if (t != NULL) {
+            return t;
+        }
+    }
+    return NULL;
+}
+
+int PerCPU_contains(u16 thread_id, PerCPUQueues *percpu) {
+    return atomic_load(&(percpu -> owner[thread_id])) != PERCPU_NO_CPU;
+}
+
+//----------------------------------- CONSTRUCTORS + DESTRUCTOR -----------------------------------
+
+void PerCPUQueues_free(PerCPUQueues *percpu) {
+    for (int i = 0; i < percpu -> cpu_count; ++i) {
+        HashQueue *queue = percpu -> cpus[i].queue;
+        queue -> freeQueue((ThreadQueue*) queue);
+    }
+    free(percpu -> cpus);
+    free((void*) percpu -> owner);
+    free(percpu);
+}
+
+/*
+    Returns 0 if cpu_count is out of range or any malloc failed, 1 otherwise.
+*/
+int init_PerCPUQueues(PerCPUQueues *this, int cpu_count) {
+    if (cpu_count < 1 || cpu_count > PERCPU_MAX_CPUS) {
+        return 0;
+    }
+
+    this -> cpu_count = cpu_count;
+    this -> cpus = aligned_alloc(CACHE_LINE_SIZE, cpu_count * sizeof(CPURunQueue));     // sizeof is a multiple of the alignment
+    this -> owner = malloc(MAX_THREADS * sizeof(_Atomic u8));
+    if (this -> cpus == NULL || this -> owner == NULL) {
+        free(this -> cpus);
+        free((void*) this -> owner);
+        return 0;
+    }
+
+    for (int i = 0; i < MAX_THREADS; ++i) {
+        atomic_init(&(this -> owner[i]), PERCPU_NO_CPU);
+    }
+
+    for (int i = 0; i < cpu_count; ++i) {
+        this -> cpus[i].queue = new_HashQueue();
+        if (this -> cpus[i].queue == NULL) {
+            while (--i >= 0) {
+                this -> cpus[i].queue -> freeQueue((ThreadQueue*) this -> cpus[i].queue);
+            }
+            free(this -> cpus);
+            free((void*) this -> owner);
+            return 0;
+        }
+        atomic_flag_clear(&(this -> cpus[i].lock));
+        atomic_init(&(this -> cpus[i].load), 0);
+    }
+
+    return 1;
+}
+
+PerCPUQueues *new_PerCPUQueues(int cpu_count) {
+    PerCPUQueues *this = malloc(sizeof(PerCPUQueues));
+    if (this == NULL) {
+        return NULL;
+    }
+    if (init_PerCPUQueues(this, cpu_count) == 0) {
+        free(this);
+        return NULL;
+    }
+    return this;
+}
@@ -0,0 +1,53 @@
+#ifndef PERCPU_QUEUE_H
+#define PERCPU_QUEUE_H
+
+#include <stdatomic.h>
+
+#include "hash-queue.h"
+
+#define PERCPU_MAX_CPUS 255
+#define PERCPU_NO_CPU ((u8) 0xFF)                          // owner of a thread ID that is not queued anywhere
+#define PERCPU_STEAL_BATCH 16                              // most Threads moved by one steal, never more than half the victim's queue
+
+typedef struct CPURunQueue CPURunQueue;
+typedef struct PerCPUQueues PerCPUQueues;
+
+/*
+    One CPU's run queue. queue is only touched with lock held,
+    load mirrors its size so other CPUs can pick a victim without locking.
+    Each run queue fills its own cache line, so one CPU's lock and load traffic never invalidates a neighbour's.
+*/
+struct CPURunQueue {
+    _Alignas(CACHE_LINE_SIZE) atomic_flag lock;
+    _Atomic int load;
+    HashQueue *queue;
+};
+
+/*
+    Per-CPU run queue layer over HashQueue:
+    - each CPU enqueues and dequeues on its own HashQueue under its own lock, there is no global lock
+    - a CPU whose queue is empty steals a batch from the tail of the most loaded neighbour,
+      leaving the neighbour's oldest (hottest) Threads where they are
+    - owner maps every queued thread ID to its CPU, so removeByID and contains find a Thread wherever it lives
+
+    No operation holds two CPU locks at once. A stolen batch is briefly held by the thief
+    between the two queues, during which owner still names the victim and removeByID retries.
+    As owner holds one CPU per ID, duplicate IDs are rejected by enqueue.
+*/
+struct PerCPUQueues {
+    int cpu_count;
+    CPURunQueue *cpus;
+    _Atomic u8 *owner;                                     // MAX_THREADS entries, PERCPU_NO_CPU if not queued
+};
+
+PerCPUQueues *new_PerCPUQueues(int cpu_count);
+int init_PerCPUQueues(PerCPUQueues*, int cpu_count);
+void PerCPUQueues_free(PerCPUQueues*);
+
+int PerCPU_enqueue(Thread*, int cpu, PerCPUQueues*);
+Thread *PerCPU_dequeue(int cpu, PerCPUQueues*);
+Thread *PerCPU_removeByID(u16, PerCPUQueues*);
+int PerCPU_contains(u16, PerCPUQueues*);
+int PerCPU_steal(int cpu, PerCPUQueues*);
+
+#endif /* PERCPU_QUEUE_H */
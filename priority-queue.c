@@ -0,0 +1,264 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "priority-queue.h"
+
+//------------------------------ Levels -----------------------------------------------------
+
+static inline u32 PriorityQueue_level(const Thread *t) {
+    return (t -> priority < PRIORITY_LEVELS) ? t -> priority : PRIORITY_LEVELS - 1;
+}
+
+/*
+    - Appends an Entry to the tail of its level, marking the level non-empty
+*/
+static void PriorityQueue_link(Entry *entry, u32 level, PriorityQueue *priorityqueue) {
+    PriorityLevel *fifo = &(priorityqueue -> levels[level]);
+
+    entry -> prev = fifo -> tail;
+    entry -> next = NULL;
+    entry -> table_index = level;
+
+    if (fifo -> tail == NULL) {
+        fifo -> head = entry;
+        priorityqueue -> nonempty |= (u64) 1 << level;
+    } else {
+        fifo -> tail -> next = entry;
+    }
+    fifo -> tail = entry;
+}
+
+/*
+    - Removes an Entry from its level, clearing the level's bit once it empties
+*/
+static void PriorityQueue_unlinkLevel(Entry *entry, PriorityQueue *priorityqueue) {
+    PriorityLevel *fifo = &(priorityqueue -> levels[entry -> table_index]);
+    Entry *prev = entry -> prev;
+    Entry *next = entry -> next;
+
+    if (prev == NULL) {
+        fifo -> head = next;
+    } else {
+        prev -> next = next;
+    }
+
+    if (next == NULL) {
+        fifo -> tail = prev;
+    } else {
+        next -> prev = prev;
+    }
+
+    if (fifo -> head == NULL) {
+        priorityqueue -> nonempty &= ~((u64) 1 << entry -> table_index);
+    }
+}
+
+//------------------------------ PriorityQueue ADT IMPLEMENTATIONS --------------------------
+
+/*
+    Returns 0 if enqueue failed (allocation failure or ID already queued), 1 if succeeded.
+    The queue never moves, so the returned queue is always the one passed in.
+*/
+static QueueResultPair PriorityQueue_enqueue(Thread *t, ThreadQueue *queue) {
+    PriorityQueue *priorityqueue = (PriorityQueue*) queue;
+    QueueResultPair result = {queue, 0};
+
+    if (priorityqueue -> index[t -> id] != NULL) {
+        return result;
+    }
+
+    Entry *new_entry = EntryPool_alloc(&(priorityqueue -> pool));
+    if (new_entry == NULL) {
+        printf("Entry memory allocation failed.\n");
+        return result;
+    }
+
+    new_entry -> t = t;
+    PriorityQueue_link(new_entry, PriorityQueue_level(t), priorityqueue);
+
+    priorityqueue -> index[t -> id] = new_entry;
+    ++ priorityqueue -> _size;
+
+    result.result = 1;
+    return result;
+}
+
+/*
+    - Unlinks an Entry from its level and the index, returning its Thread
+*/
+static Thread *PriorityQueue_unlink(Entry *entry, PriorityQueue *priorityqueue) {
+    PriorityQueue_unlinkLevel(entry, priorityqueue);
+
+    Thread *t = entry -> t;
+    priorityqueue -> index[t -> id] = NULL;
+    -- priorityqueue -> _size;
+
+    EntryPool_release(entry, &(priorityqueue -> pool));
+    return t;
+}
+
+/*
+    - The lowest set bit of nonempty is the highest priority level holding a Thread
+*/
+static Thread *PriorityQueue_dequeue(ThreadQueue *queue) {
+    PriorityQueue *priorityqueue = (PriorityQueue*) queue;
+
+    if (priorityqueue -> nonempty == 0) {
+        return NULL;
+    }
+
+    const int level = __builtin_ctzll(priorityqueue -> nonempty);
+    return PriorityQueue_unlink(priorityqueue -> levels[level].head, priorityqueue);
+}
+
+static Thread *PriorityQueue_removeByID(u16 thread_id, ThreadQueue *queue) {
+    PriorityQueue *priorityqueue = (PriorityQueue*) queue;
+    Entry *entry = priorityqueue -> index[thread_id];
+
+    if (entry == NULL) {
+        return NULL;
+    }
+
+    return PriorityQueue_unlink(entry, priorityqueue);
+}
+
+static Thread *PriorityQueue_getByID(u16 thread_id, ThreadQueue *queue) {
+    PriorityQueue *priorityqueue = (PriorityQueue*) queue;
+    Entry *entry = priorityqueue -> index[thread_id];
+    return (entry == NULL) ? NULL : entry -> t;
+}
+
+static int PriorityQueue_contains(u16 thread_id, ThreadQueue *queue) {
+    PriorityQueue *priorityqueue = (PriorityQueue*) queue;
+    return (priorityqueue -> index[thread_id] != NULL);
+}
+
+static int PriorityQueue_isEmpty(ThreadQueue *queue) {
+    PriorityQueue *priorityqueue = (PriorityQueue*) queue;
+    return (priorityqueue -> _size == 0);
+}
+
+static int PriorityQueue_size(ThreadQueue *queue) {
+    PriorityQueue *priorityqueue = (PriorityQueue*) queue;
+    return priorityqueue -> _size;
+}
+
+/*
+    - Moves a queued Thread to the tail of the level for its new priority, as a priority boost or decay would
+    - An ID that is not queued is a no-op, as there is no Thread to update
+    Returns 1 if thread_id was queued, 0 otherwise.
+*/
+int PriorityQueue_setPriority(u16 thread_id, u8 priority, PriorityQueue *priorityqueue) {
+    Entry *entry = priorityqueue -> index[thread_id];
+    if (entry == NULL) {
+        return 0;
+    }
+
+    entry -> t -> priority = priority;
+    PriorityQueue_unlinkLevel(entry, priorityqueue);
+    PriorityQueue_link(entry, PriorityQueue_level(entry -> t), priorityqueue);
+    return 1;
+}
+
+//----------------------------------- ITERATOR FUNCTIONS  -----------------------------------------
+
+/*
+    - currentIndex is the level of currentEntry, the next level is found from the bitmap
+      with every level up to the current one masked off
+*/
+static Thread *PriorityIterator_next(Iterator *iterator) {
+    PriorityQueue *priorityqueue = (PriorityQueue*) iterator -> queue;
+    Entry *curr = iterator -> currentEntry;
+
+    iterator -> currentEntry = curr -> next;
+    if (iterator -> currentEntry == NULL && iterator -> currentIndex < PRIORITY_LEVELS - 1) {
+        const u64 later = priorityqueue -> nonempty & (~(u64) 0 << (iterator -> currentIndex + 1));
+        if (later != 0) {
+            iterator -> currentIndex = __builtin_ctzll(later);
+            iterator -> currentEntry = priorityqueue -> levels[iterator -> currentIndex].head;
+        }
+    }
+    return curr -> t;
+}
+
+static int PriorityIterator_hasNext(Iterator *iterator) {
+    return iterator -> currentEntry != NULL;
+}
+
+static Iterator *new_PriorityIterator(ThreadQueue *queue) {
+    PriorityQueue *priorityqueue = (PriorityQueue*) queue;
+    Iterator *iterator = malloc(sizeof(Iterator));
+    if (iterator == NULL) {
+        return NULL;
+    }
+
+    iterator -> hasNext = PriorityIterator_hasNext;
+    iterator -> next = PriorityIterator_next;
+    iterator -> currentEntry = NULL;
+    iterator -> queue = queue;
+    iterator -> remaining = 0;
+    iterator -> currentIndex = 0;
+
+    if (priorityqueue -> nonempty != 0) {
+        iterator -> currentIndex = __builtin_ctzll(priorityqueue -> nonempty);
+        iterator -> currentEntry = priorityqueue -> levels[iterator -> currentIndex].head;
+    }
+
+    return iterator;
+}
+
+//----------------------------------- CONSTRUCTORS + DESTRUCTOR -----------------------------------
+
+static void PriorityQueue_free(ThreadQueue *queue) {
+    PriorityQueue *priorityqueue = (PriorityQueue*) queue;
+    EntryPool_free(&(priorityqueue -> pool));
+    free(priorityqueue -> index);
+    free(priorityqueue);
+}
+
+/*
+    Returns 0 if any malloc failed, 1 otherwise.
+*/
+int init_PriorityQueue(PriorityQueue *this) {
+    this -> _size = 0;
+    this -> nonempty = 0;
+    for (int i = 0; i < PRIORITY_LEVELS; ++i) {
+        this -> levels[i].head = NULL;
+        this -> levels[i].tail = NULL;
+    }
+    this -> index = calloc(MAX_THREADS, sizeof(Entry*));
+    if (this -> index == NULL) {
+        return 0;
+    }
+
+    if (init_EntryPool(&(this -> pool)) == 0) {
+        free(this -> index);
+        return 0;
+    }
+
+    this -> dequeue = PriorityQueue_dequeue;
+    this -> contains = PriorityQueue_contains;
+    this -> enqueue = PriorityQueue_enqueue;
+    this -> isEmpty = PriorityQueue_isEmpty;
+    this -> removeByID = PriorityQueue_removeByID;
+    this -> getByID = PriorityQueue_getByID;
+    this -> iterator = new_PriorityIterator;
+    this -> size = PriorityQueue_size;
+    this -> freeQueue = PriorityQueue_free;
+    this -> enqueueBatch = ThreadQueue_enqueueEach;
+    this -> dequeueN = ThreadQueue_dequeueEach;
+
+    return 1;
+}
+
+PriorityQueue *new_PriorityQueue() {
+    PriorityQueue *this = malloc(sizeof(PriorityQueue));
+    if (this == NULL) {
+        return NULL;
+    }
+    if (init_PriorityQueue(this) == 0) {
+        free(this);
+        return NULL;
+    }
+    return this;
+}
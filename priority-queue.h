@@ -0,0 +1,56 @@
+#ifndef PRIORITY_QUEUE_H
+#define PRIORITY_QUEUE_H
+
+#include "hash-queue.h"
+
+#define PRIORITY_LEVELS 64                                 // one bit per level in PriorityQueue.nonempty, Thread.priority 0 is highest
+
+typedef struct PriorityLevel PriorityLevel;
+typedef struct PriorityQueue PriorityQueue;
+
+/*
+    FIFO of the Threads queued at one priority
+*/
+struct PriorityLevel {
+    Entry *head;
+    Entry *tail;
+};
+
+/*
+    ThreadQueue backend with PRIORITY_LEVELS FIFO levels:
+    - enqueue appends to the level given by Thread.priority, priorities past the last level share it
+    - dequeue takes the head of the highest priority non-empty level, found by a single
+      count-trailing-zeros of the nonempty bitmap
+    - every level shares one direct-mapped ID index, so contains/getByID/removeByID never search levels
+    - Entries are drawn from the same EntryPool as the HashQueue, each Entry's table_index holds its level
+
+    Iteration visits levels from highest priority, each in FIFO order, as dequeue would.
+    As each ID owns exactly one index slot, duplicate IDs are rejected by enqueue.
+*/
+struct PriorityQueue {
+    // Common Queue Interface
+    Thread* (*dequeue) (ThreadQueue*);                     // Input: queue. Output: dequeued element
+    int (*contains) (u16, ThreadQueue*);                   // success/failure return value
+    QueueResultPair (*enqueue) (Thread*, ThreadQueue*);    // Inputs: enqueue element, queue. Output: queue pointer, enqueue success/failure
+    int (*isEmpty) (ThreadQueue*);                         // success/failure return value
+    Thread* (*removeByID) (u16, ThreadQueue*);             // Inputs: ID, queue. Output: removed element
+    Thread* (*getByID) (u16, ThreadQueue*);                // Returns a reference to the Thread, but does not remove
+    Iterator* (*iterator)(ThreadQueue*);
+    int (*size) (ThreadQueue*);                            // Returns the number of elements in the PriorityQueue
+    void (*freeQueue) (ThreadQueue*);
+    QueueResultPair (*enqueueBatch) (Thread**, int, ThreadQueue*);  // Inputs: elements, count, queue. Output: queue pointer, number enqueued
+    int (*dequeueN) (Thread**, int, ThreadQueue*);                  // Inputs: output array, max count, queue. Output: number dequeued, highest priority first
+
+    // Priority Queue only
+    int _size;
+    u64 nonempty;                                          // bit i set while levels[i] holds a Thread
+    PriorityLevel levels[PRIORITY_LEVELS];
+    Entry **index;                                         // MAX_THREADS slots, index[id] is the Entry for id or NULL
+    EntryPool pool;
+};
+
+PriorityQueue *new_PriorityQueue();
+int init_PriorityQueue(PriorityQueue*);
+int PriorityQueue_setPriority(u16 thread_id, u8 priority, PriorityQueue*);
+
+#endif /* PRIORITY_QUEUE_H */
@@ -0,0 +1,241 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "sharded-queue.h"
+
+//------------------------------ Shards -----------------------------------------------------
+
+/*
+    - Fibonacci hashing on the top bits, so shards don't share low ID bits
+      with the HashQueue tables inside them
+*/
+static inline Shard *ShardedQueue_shard(u16 thread_id, ShardedQueue *shardedqueue) {
+    const u32 shard = ((u32) thread_id * 0x9E3779B1u) >> (32 - SHARDED_QUEUE_SHARD_BITS);
+    return &(shardedqueue -> shards[shard]);
+}
+
+static inline void Shard_lock(Shard *shard) {
+    while (atomic_flag_test_and_set_explicit(&(shard -> lock), memory_order_acquire)) {
+        // spin, critical sections are a single HashQueue operation
+    }
+}
+
+/*
+    - Republishes head_seq, which may have changed, then releases the shard
+*/
+static inline void Shard_unlock(Shard *shard) {
+    const Entry *head = shard -> queue -> head;
+    atomic_store_explicit(&(shard -> head_seq), (head == NULL) ? SHARD_EMPTY_SEQ : head -> t -> enqueue_seq, memory_order_relaxed);
+    atomic_flag_clear_explicit(&(shard -> lock), memory_order_release);
+}
+
+//------------------------------ ShardedQueue ADT IMPLEMENTATIONS ---------------------------
+
+/*
+    Returns 0 if enqueue failed, 1 if succeeded.
+    The queue never moves, so the returned queue is always the one passed in.
+*/
+static QueueResultPair ShardedQueue_enqueue(Thread *t, ThreadQueue *queue) {
+    ShardedQueue *shardedqueue = (ShardedQueue*) queue;
+    Shard *shard = ShardedQueue_shard(t -> id, shardedqueue);
+    QueueResultPair result = {queue, 0};
+
+    Shard_lock(shard);
+    t -> enqueue_seq = atomic_fetch_add_explicit(&(shardedqueue -> next_seq), 1, memory_order_relaxed);
+    result.result = shard -> queue -> enqueue(t, (ThreadQueue*) shard -> queue).result;
+    Shard_unlock(shard);
+
+    if (result.result == 1) {
+        atomic_fetch_add_explicit(&(shardedqueue -> _size), 1, memory_order_relaxed);
+    }
+    return result;
+}
+
+/*
+    Dequeue procedure
+        - Find the shard whose head has the lowest sequence number, from the published head_seqs
+        - Lock it, and take its head if that is still the Thread we picked
+        - Otherwise another CPU got there first, so pick again
+*/
+static Thread *ShardedQueue_dequeue(ThreadQueue *queue) {
+    ShardedQueue *shardedqueue = (ShardedQueue*) queue;
+
+    while (1) {
+        Shard *oldest = NULL;
+        u64 oldest_seq = SHARD_EMPTY_SEQ;
+
+        for (int i = 0; i < SHARDED_QUEUE_SHARDS; ++i) {
+            const u64 seq = atomic_load_explicit(&(shardedqueue -> shards[i].head_seq), memory_order_relaxed);
+            if (seq < oldest_seq) {
+                oldest = &(shardedqueue -> shards[i]);
+                oldest_seq = seq;
+            }
+        }
+        if (oldest == NULL) {
+            return NULL;
+        }
+
+        Thread *t = NULL;
+        Shard_lock(oldest);
+        const Entry *head = oldest -> queue -> head;
+        if (head != NULL && head -> t -> enqueue_seq == oldest_seq) {
+            t = oldest -> queue -> dequeue((ThreadQueue*) oldest -> queue);
+        }
+        Shard_unlock(oldest);
+
+        if (t != NULL) {
+            atomic_fetch_sub_explicit(&(shardedqueue -> _size), 1, memory_order_relaxed);
+            return t;
+        }
+    }
+}
+
+static Thread *ShardedQueue_removeByID(u16 thread_id, ThreadQueue *queue) {
+    ShardedQueue *shardedqueue = (ShardedQueue*) queue;
+    Shard *shard = ShardedQueue_shard(thread_id, shardedqueue);
+
+    Shard_lock(shard);
+    Thread *t = shard -> queue -> removeByID(thread_id, (ThreadQueue*) shard -> queue);
+    Shard_unlock(shard);
+
+    if (t != NULL) {
+        atomic_fetch_sub_explicit(&(shardedqueue -> _size), 1, memory_order_relaxed);
+    }
+    return t;
+}
+
+static Thread *ShardedQueue_getByID(u16 thread_id, ThreadQueue *queue) {
+    Shard *shard = ShardedQueue_shard(thread_id, (ShardedQueue*) queue);
+
+    Shard_lock(shard);
+    Thread *t = shard -> queue -> getByID(thread_id, (ThreadQueue*) shard -> queue);
+    Shard_unlock(shard);
+    return t;
+}
+
+static int ShardedQueue_contains(u16 thread_id, ThreadQueue *queue) {
+    Shard *shard = ShardedQueue_shard(thread_id, (ShardedQueue*) queue);
+
+    Shard_lock(shard);
+    const int found = shard -> queue -> contains(thread_id, (ThreadQueue*) shard -> queue);
+    Shard_unlock(shard);
+    return found;
+}
+
+static int ShardedQueue_isEmpty(ThreadQueue *queue) {
+    ShardedQueue *shardedqueue = (ShardedQueue*) queue;
+    return (atomic_load(&(shardedqueue -> _size)) == 0);
+}
+
+static int ShardedQueue_size(ThreadQueue *queue) {
+    ShardedQueue *shardedqueue = (ShardedQueue*) queue;
+    return atomic_load(&(shardedqueue -> _size));
+}
+
+//----------------------------------- ITERATOR FUNCTIONS  -----------------------------------------
+
+/*
+    - Merges the shard FIFOs, each cursor is the next unvisited Entry of its shard
+*/
+static Thread *ShardedIterator_next(Iterator *iterator) {
+    int oldest = 0;
+    for (int i = 1; i < SHARDED_QUEUE_SHARDS; ++i) {
+        if (iterator -> cursors[i] != NULL &&
+            (iterator -> cursors[oldest] == NULL || iterator -> cursors[i] -> t -> enqueue_seq < iterator -> cursors[oldest] -> t -> enqueue_seq)) {
+            oldest = i;
+        }
+    }
+
+    Entry *curr = iterator -> cursors[oldest];
+    iterator -> cursors[oldest] = curr -> next;
+    -- iterator -> remaining;
+    return curr -> t;
+}
+
+static int ShardedIterator_hasNext(Iterator *iterator) {
+    return iterator -> remaining > 0;
+}
+
+/*
+    The cursors share the Iterator's allocation, so callers free it as any other Iterator.
+*/
+static Iterator *new_ShardedIterator(ThreadQueue *queue) {
+    ShardedQueue *shardedqueue = (ShardedQueue*) queue;
+    Iterator *iterator = malloc(sizeof(Iterator) + SHARDED_QUEUE_SHARDS * sizeof(Entry*));
+    if (iterator == NULL) {
+        return NULL;
+    }
+
+    iterator -> hasNext = ShardedIterator_hasNext;
+    iterator -> next = ShardedIterator_next;
+    iterator -> currentEntry = NULL;
+    iterator -> queue = queue;
+    iterator -> remaining = atomic_load(&(shardedqueue -> _size));
+    iterator -> cursors = (Entry**) (iterator + 1);
+
+    for (int i = 0; i < SHARDED_QUEUE_SHARDS; ++i) {
+        iterator -> cursors[i] = shardedqueue -> shards[i].queue -> head;
+    }
+
+    return iterator;
+}
+
+//----------------------------------- CONSTRUCTORS + DESTRUCTOR -----------------------------------
+
+static void ShardedQueue_free(ThreadQueue *queue) {
+    ShardedQueue *shardedqueue = (ShardedQueue*) queue;
+    for (int i = 0; i < SHARDED_QUEUE_SHARDS; ++i) {
+        HashQueue *shard_queue = shardedqueue -> shards[i].queue;
+        shard_queue -> freeQueue((ThreadQueue*) shard_queue);
+    }
+    free(shardedqueue);
+}
+
+/*
+    Returns 0 if any malloc failed, 1 otherwise.
+*/
+int init_ShardedQueue(ShardedQueue *this) {
+    atomic_init(&(this -> next_seq), 0);
+    atomic_init(&(this -> _size), 0);
+
+    for (int i = 0; i < SHARDED_QUEUE_SHARDS; ++i) {
+        this -> shards[i].queue = new_HashQueue();
+        if (this -> shards[i].queue == NULL) {
+            while (--i >= 0) {
+                this -> shards[i].queue -> freeQueue((ThreadQueue*) this -> shards[i].queue);
+            }
+            return 0;
+        }
+        atomic_flag_clear(&(this -> shards[i].lock));
+        atomic_init(&(this -> shards[i].head_seq), SHARD_EMPTY_SEQ);
+    }
+
+    this -> dequeue = ShardedQueue_dequeue;
+    this -> contains = ShardedQueue_contains;
+    this -> enqueue = ShardedQueue_enqueue;
+    this -> isEmpty = ShardedQueue_isEmpty;
+    this -> removeByID = ShardedQueue_removeByID;
+    this -> getByID = ShardedQueue_getByID;
+    this -> iterator = new_ShardedIterator;
+    this -> size = ShardedQueue_size;
+    this -> freeQueue = ShardedQueue_free;
+    this -> enqueueBatch = ThreadQueue_enqueueEach;
+    this -> dequeueN = ThreadQueue_dequeueEach;
+
+    return 1;
+}
+
+/*
+    Allocated cache line aligned, as the shards are.
+*/
+ShardedQueue *new_ShardedQueue() {
+    ShardedQueue *this = aligned_alloc(CACHE_LINE_SIZE, sizeof(ShardedQueue));
+    if (this == NULL) {
+        return NULL;
+    }
+    if (init_ShardedQueue(this) == 0) {
+        free(this);
+        return NULL;
+    }
+    return this;
+}
@@ -0,0 +1,60 @@
+#ifndef SHARDED_QUEUE_H
+#define SHARDED_QUEUE_H
+
+#include <stdatomic.h>
+
+#include "hash-queue.h"
+
+#define SHARDED_QUEUE_SHARD_BITS 4
+#define SHARDED_QUEUE_SHARDS (1 << SHARDED_QUEUE_SHARD_BITS)
+#define SHARD_EMPTY_SEQ (~(u64) 0)                         // head_seq of an empty shard
+
+typedef struct Shard Shard;
+typedef struct ShardedQueue ShardedQueue;
+
+/*
+    A slice of the ID space with its own HashQueue and lock.
+    head_seq mirrors the enqueue_seq of the shard's head so dequeue can compare shards without locking.
+    Shards are cache line aligned so CPUs working on different shards don't share lines.
+*/
+struct Shard {
+    _Alignas(CACHE_LINE_SIZE) atomic_flag lock;
+    _Atomic u64 head_seq;
+    HashQueue *queue;
+};
+
+/*
+    Concurrent ThreadQueue backend, safe to call from any number of CPUs:
+    - thread IDs are split over SHARDED_QUEUE_SHARDS shards, so contains/getByID/removeByID
+      only ever lock the one shard owning the ID
+    - enqueue stamps each Thread with a global sequence number while holding its shard's lock,
+      so every shard's FIFO is sorted by sequence number
+    - dequeue takes the shard head with the lowest sequence number, which is the oldest Thread overall,
+      preserving HashQueue's FIFO order
+
+    Iterators are not safe against concurrent modification.
+*/
+struct ShardedQueue {
+    // Common Queue Interface
+    Thread* (*dequeue) (ThreadQueue*);                     // Input: queue. Output: dequeued element
+    int (*contains) (u16, ThreadQueue*);                   // success/failure return value
+    QueueResultPair (*enqueue) (Thread*, ThreadQueue*);    // Inputs: enqueue element, queue. Output: queue pointer, enqueue success/failure
+    int (*isEmpty) (ThreadQueue*);                         // success/failure return value
+    Thread* (*removeByID) (u16, ThreadQueue*);             // Inputs: ID, queue. Output: removed element
+    Thread* (*getByID) (u16, ThreadQueue*);                // Returns a reference to the Thread, but does not remove
+    Iterator* (*iterator)(ThreadQueue*);
+    int (*size) (ThreadQueue*);                            // Returns the number of elements in the ShardedQueue
+    void (*freeQueue) (ThreadQueue*);
+    QueueResultPair (*enqueueBatch) (Thread**, int, ThreadQueue*);  // Inputs: elements, count, queue. Output: queue pointer, number enqueued
+    int (*dequeueN) (Thread**, int, ThreadQueue*);                  // Inputs: output array, max count, queue. Output: number dequeued, oldest first
+
+    // Sharded Queue only
+    _Atomic u64 next_seq;
+    _Atomic int _size;
+    Shard shards[SHARDED_QUEUE_SHARDS];
+};
+
+ShardedQueue *new_ShardedQueue();
+int init_ShardedQueue(ShardedQueue*);
+
+#endif /* SHARDED_QUEUE_H */
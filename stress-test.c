@@ -5,16 +5,19 @@
 
 
 #include "hash-queue.h"
+#include "direct-queue.h"
+#include "swiss-queue.h"
+#include "index-queue.h"
+#include "sharded-queue.h"
+#include "priority-queue.h"
+
+#define WAKE_BATCH_SIZE 64                  // Threads released together, e.g. by a barrier
 
 static ThreadQueue *threadqueue;
 static HashQueue *hashqueue;
 static Thread *threads[MAX_THREADS];
 
 static void setup() {
-    threadqueue = (ThreadQueue*) new_HashQueue();
-    hashqueue = (HashQueue*) threadqueue;
-    //hashqueue -> getHash = IDHash;
-
     for (int i = 0; i < MAX_THREADS; ++i) {
         threads[i] = malloc(sizeof(Thread));
         if (threads[i] == NULL) {
@@ -22,12 +25,12 @@ static void setup() {
             exit(0);
         } else {
             threads[i] -> id = i;
+            threads[i] -> priority = i % PRIORITY_LEVELS;
         }
     }
 }
 
 static void wrapUp() {
-    threadqueue -> freeQueue(threadqueue);
     for (int i = 0; i < MAX_THREADS; ++i) {
         free(threads[i]);
     }
@@ -42,6 +45,12 @@ static void enqueueAll(void) {
     hashqueue = (HashQueue*) threadqueue;
 }
 
+static void enqueueBatchAll(void) {
+    for (int i = 0; i < MAX_THREADS; i += WAKE_BATCH_SIZE) {
+        threadqueue -> enqueueBatch(&threads[i], WAKE_BATCH_SIZE, threadqueue);
+    }
+}
+
 static void removeByIDAll(void) {
     Thread *removed;
     for (int i = 0; i < MAX_THREADS; ++i) {
@@ -84,6 +93,39 @@ static double timeFunction(void (*testFunction) (void)) {
     return ((double) (end - begin)  * 1000) / CLOCKS_PER_SEC;
 }
 
+/*
+    Times each enqueue individually, returning the slowest (ms)
+    Eager rehashing stalls a single enqueue, incremental rehashing spreads the cost out
+*/
+static double worstEnqueueLatency(void) {
+    double worst = 0.0;
+    for (int i = 0; i < MAX_THREADS; ++i) {
+        clock_t begin = clock();
+        threadqueue -> enqueue(threads[i], threadqueue);
+        clock_t end = clock();
+        const double elapsed = ((double) (end - begin) * 1000) / CLOCKS_PER_SEC;
+        if (elapsed > worst) {
+            worst = elapsed;
+        }
+    }
+    return worst;
+}
+
+/*
+    - Counts Entries whose table_index disagrees with where a lookup finds them
+*/
+static int countMisplacedEntries(void) {
+    int misplaced = 0;
+    Entry *entry;
+
+    hashqueue_for_each_entry(entry, hashqueue) {
+        if (hashqueue -> getEntryByID(entry -> t -> id, threadqueue) != entry) {
+            ++ misplaced;
+        }
+    }
+    return misplaced;
+}
+
 static void enqueueHalf(void) {
     QueueResultPair result;
     for (int i = 0; i < 65535; i += 2) {
@@ -319,6 +361,42 @@ static void t7(void) {
     - table entries not set to null are erroneously being freed?
 */
 
+/*
+    Times the common operations against whichever queue threadqueue currently holds
+*/
+static void runBenchmarks(const char *label) {
+    printf("%s\n", label);
+
+    const double enqueue_time = timeFunction(enqueueAll);
+    printf("Enqueue all time elapsed (ms): %f\n", enqueue_time);
+    
+    //const double dequeue_time = timeFunction(dequeueAll);
+    //printf("Dequeue all time elapsed (ms): %f\n", dequeue_time);
+
+    //enqueueAll();
+    const double remove_time = timeFunction(removeByIDAll);
+    printf("remove all time elapsed (ms): %f\n", remove_time);
+
+
+    enqueueAll();
+    const double remove_reverse = timeFunction(removeByIDReversedAll);
+    printf("remove all by reverse order time elapsed (ms): %f\n", remove_reverse);
+
+    assert(threadqueue -> size(threadqueue) == 0);
+
+    enqueueAll();
+    const double contains_time = timeFunction(containsAll);
+    printf("contains all time elapsed (ms): %f\n", contains_time);
+
+    const double contains_reversed = timeFunction(containsAllReversed);
+    printf("contains all reversed time elapsed (ms): %f\n", contains_reversed);
+
+    removeByIDAll();
+    const double batch_time = timeFunction(enqueueBatchAll);
+    printf("Enqueue all in batches of %d time elapsed (ms): %f\n", WAKE_BATCH_SIZE, batch_time);
+    assert(threadqueue -> size(threadqueue) == MAX_THREADS);
+}
+
 int main() {
 
     setup();
@@ -345,54 +423,50 @@ int main() {
 
     */
 
-    const double enqueue_time = timeFunction(enqueueAll);
-    printf("Enqueue all time elapsed (ms): %f\n", enqueue_time);
-    
-    //const double dequeue_time = timeFunction(dequeueAll);
-    //printf("Dequeue all time elapsed (ms): %f\n", dequeue_time);
-
-    //enqueueAll();
-    const double remove_time = timeFunction(removeByIDAll);
-    printf("remove all time elapsed (ms): %f\n", remove_time);
-
-
-    enqueueAll();
-    const double remove_reverse = timeFunction(removeByIDReversedAll);
-    printf("remove all by reverse order time elapsed (ms): %f\n", remove_reverse);
+    threadqueue = (ThreadQueue*) new_HashQueue();
+    hashqueue = (HashQueue*) threadqueue;
+    //hashqueue -> getHash = IDHash;
+    runBenchmarks("HashQueue (Robin Hood probing)");
+#ifdef HASHQUEUE_STATS
+    HashQueue_dumpStats(hashqueue);
+#endif
+    threadqueue -> freeQueue(threadqueue);
 
-    assert(threadqueue -> size(threadqueue) == 0);
+    threadqueue = (ThreadQueue*) new_DirectQueue();
+    runBenchmarks("DirectQueue (direct-mapped)");
+    threadqueue -> freeQueue(threadqueue);
 
-    enqueueAll();
-    const double contains_time = timeFunction(containsAll);
-    printf("contains all time elapsed (ms): %f\n", contains_time);
+    threadqueue = (ThreadQueue*) new_SwissQueue();
+    runBenchmarks("SwissQueue (group probing)");
+    threadqueue -> freeQueue(threadqueue);
 
-    const double contains_reversed = timeFunction(containsAllReversed);
-    printf("contains all reversed time elapsed (ms): %f\n", contains_reversed);
+    threadqueue = (ThreadQueue*) new_IndexQueue();
+    runBenchmarks("IndexQueue (16-bit index links)");
+    threadqueue -> freeQueue(threadqueue);
 
+    threadqueue = (ThreadQueue*) new_ShardedQueue();
+    runBenchmarks("ShardedQueue (per-shard locks)");
+    threadqueue -> freeQueue(threadqueue);
 
+    threadqueue = (ThreadQueue*) new_PriorityQueue();
+    runBenchmarks("PriorityQueue (64 levels)");
+    threadqueue -> freeQueue(threadqueue);
 
-    
+    threadqueue = (ThreadQueue*) new_HashQueue();
+    printf("Worst single enqueue, eager rehash (ms): %f\n", worstEnqueueLatency());
+    threadqueue -> freeQueue(threadqueue);
 
-    /*
-    Iterator *iterator = threadqueue -> iterator(threadqueue);
-    int c = 0;
-    while (iterator -> hasNext(iterator)) {
-        Entry *curr = iterator -> currentEntry;
-        u16 thread_id = curr -> t -> id;
-        u16 inner_ref = curr -> table_index;    // where entry believes it is
-        u16 table_ref = hashqueue -> getTableIndex(thread_id, threadqueue);
-        if (inner_ref != table_ref) {
-            //printf("Table believes entry is at %u\n"
-                   // "Entry believes it is at %u\n\n", table_ref, inner_ref);
-            ++c;
-        }
+    threadqueue = (ThreadQueue*) new_HashQueue_with(MAX_THREADS, 0.0);
+    printf("Worst single enqueue, reserved table (ms): %f\n", worstEnqueueLatency());
+    threadqueue -> freeQueue(threadqueue);
 
-        
-        iterator -> next(iterator);
-    }
-    printf("bad counts: %d\n", c);
+    threadqueue = (ThreadQueue*) new_HashQueue();
+    hashqueue = (HashQueue*) threadqueue;
+    hashqueue -> incremental_rehash = 1;
+    printf("Worst single enqueue, incremental rehash (ms): %f\n", worstEnqueueLatency());
+    printf("bad counts: %d\n", countMisplacedEntries());
+    threadqueue -> freeQueue(threadqueue);
 
-    */
     wrapUp();
 
     return 0;    
@@ -0,0 +1,367 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "swiss-queue.h"
+
+//------------------------------ Group Matching ---------------------------------------------
+
+/*
+    Each function returns a bitmask with bit i set if control byte i of the group matches
+*/
+#if defined(__SSE2__)
+
+static inline u32 SwissGroup_match(const u8 *group, u8 byte) {
+    const __m128i control = _mm_loadu_si128((const __m128i*) group);
+    return (u32) _mm_movemask_epi8(_mm_cmpeq_epi8(control, _mm_set1_epi8((char) byte)));
+}
+
+// SWISS_EMPTY and SWISS_DELETED are the only control bytes with the top bit set
+static inline u32 SwissGroup_matchEmptyOrDeleted(const u8 *group) {
+    return (u32) _mm_movemask_epi8(_mm_loadu_si128((const __m128i*) group));
+}
+
+#else
+
+static inline u32 SwissGroup_match(const u8 *group, u8 byte) {
+    u32 mask = 0;
+    for (int i = 0; i < SWISS_GROUP_WIDTH; ++i) {
+        mask |= (u32) (group[i] == byte) << i;
+    }
+    return mask;
+}
+
+static inline u32 SwissGroup_matchEmptyOrDeleted(const u8 *group) {
+    u32 mask = 0;
+    for (int i = 0; i < SWISS_GROUP_WIDTH; ++i) {
+        mask |= (u32) (group[i] >> 7) << i;
+    }
+    return mask;
+}
+
+#endif
+
+//------------------------------ SwissQueue ADT IMPLEMENTATIONS -----------------------------
+
+/*
+    Probe sequence
+        - The high hash bits pick the first group, the low 7 bits are the fingerprint
+        - Groups are visited in triangular steps (1, 2, 3 ...), which visits every group
+          when the number of groups is a power of 2
+*/
+static inline u32 SwissQueue_firstGroup(u32 hash, u32 group_mask) {
+    return (hash >> 7) & group_mask;
+}
+
+/*
+    - Returns the slot holding thread_id, or -1 if not found
+    - The search ends at the first group with an empty slot, as insertion never skips one
+*/
+static int SwissQueue_findSlot(u16 thread_id, SwissQueue *swissqueue) {
+    const u32 hash = swissqueue -> getHash(thread_id);
+    const u8 fingerprint = hash & SWISS_FINGERPRINT_MASK;
+    const u32 group_mask = (swissqueue -> capacity / SWISS_GROUP_WIDTH) - 1;
+    u32 group = SwissQueue_firstGroup(hash, group_mask);
+
+    for (u32 stride = 1; stride <= group_mask + 1; ++stride) {
+        const u8 *control = swissqueue -> control + group * SWISS_GROUP_WIDTH;
+        u32 matches = SwissGroup_match(control, fingerprint);
+
+        while (matches != 0) {
+            const u32 slot = group * SWISS_GROUP_WIDTH + __builtin_ctz(matches);
+            if (swissqueue -> keys[slot] == thread_id) {
+                return (int) slot;
+            }
+            matches &= matches - 1;
+        }
+
+        if (SwissGroup_match(control, SWISS_EMPTY) != 0) {
+            return -1;
+        }
+        group = (group + stride) & group_mask;
+    }
+    return -1;
+}
+
+/*
+    - Places an Entry in the first empty or deleted slot along its probe sequence
+*/
+static void SwissQueue_place(Entry *entry, u8 *control, u16 *keys, Entry **slots, int capacity, SwissQueue *swissqueue) {
+    const u16 thread_id = entry -> t -> id;
+    const u32 hash = swissqueue -> getHash(thread_id);
+    const u32 group_mask = (capacity / SWISS_GROUP_WIDTH) - 1;
+    u32 group = SwissQueue_firstGroup(hash, group_mask);
+    u32 available;
+
+    for (u32 stride = 1; (available = SwissGroup_matchEmptyOrDeleted(control + group * SWISS_GROUP_WIDTH)) == 0; ++stride) {
+        group = (group + stride) & group_mask;
+    }
+
+    const u32 slot = group * SWISS_GROUP_WIDTH + __builtin_ctz(available);
+    if (control[slot] == SWISS_DELETED) {
+        -- swissqueue -> tombstones;
+    }
+    control[slot] = hash & SWISS_FINGERPRINT_MASK;
+    keys[slot] = thread_id;
+    slots[slot] = entry;
+    entry -> table_index = slot;
+}
+
+/*
+    Returns 0 if enqueue failed, 1 if succeeded.
+    The table is rebuilt once full and deleted slots pass 7/8 of capacity:
+    doubled if live entries exceed 7/16, otherwise rebuilt at the same size to purge tombstones.
+*/
+static QueueResultPair SwissQueue_enqueue(Thread *t, ThreadQueue *queue) {
+    SwissQueue *swissqueue = (SwissQueue*) queue;
+    QueueResultPair result = {queue, 0};
+
+    Entry *new_entry = EntryPool_alloc(&(swissqueue -> pool));
+    if (new_entry == NULL) {
+        printf("Entry memory allocation failed.\n");
+        return result;
+    }
+
+    new_entry -> prev = swissqueue -> tail;
+    new_entry -> next = NULL;
+    new_entry -> t = t;
+
+    if (swissqueue -> tail == NULL) {
+        swissqueue -> head = new_entry;
+    } else {
+        swissqueue -> tail -> next = new_entry;
+    }
+    swissqueue -> tail = new_entry;
+
+    SwissQueue_place(new_entry, swissqueue -> control, swissqueue -> keys, swissqueue -> slots, swissqueue -> capacity, swissqueue);
+    ++ swissqueue -> _size;
+    result.result = 1;
+
+    const int capacity = swissqueue -> capacity;
+    if ((swissqueue -> _size + swissqueue -> tombstones) * 8 > capacity * 7) {
+        const int new_capacity = (swissqueue -> _size * 16 > capacity * 7) ? capacity * 2 : capacity;
+        result.result = SwissQueue_rehash(swissqueue, new_capacity);
+    }
+
+    return result;
+}
+
+/*
+    - Unlinks an Entry from the FIFO and clears its slot
+    - The slot can only be marked empty if its group already has an empty slot,
+      otherwise some probe sequence may have passed through the group, so a tombstone is left
+*/
+static Thread *SwissQueue_removeEntry(Entry *entry, SwissQueue *swissqueue) {
+    Entry *prev = entry -> prev;
+    Entry *next = entry -> next;
+
+    if (prev == NULL) {
+        swissqueue -> head = next;
+    } else {
+        prev -> next = next;
+    }
+
+    if (next == NULL) {
+        swissqueue -> tail = prev;
+    } else {
+        next -> prev = prev;
+    }
+
+    const u32 slot = entry -> table_index;
+    const u8 *group = swissqueue -> control + (slot & ~(u32) (SWISS_GROUP_WIDTH - 1));
+    if (SwissGroup_match(group, SWISS_EMPTY) != 0) {
+        swissqueue -> control[slot] = SWISS_EMPTY;
+    } else {
+        swissqueue -> control[slot] = SWISS_DELETED;
+        ++ swissqueue -> tombstones;
+    }
+    swissqueue -> slots[slot] = NULL;
+    -- swissqueue -> _size;
+
+    Thread *t = entry -> t;
+    EntryPool_release(entry, &(swissqueue -> pool));
+    return t;
+}
+
+static Thread *SwissQueue_dequeue(ThreadQueue *queue) {
+    SwissQueue *swissqueue = (SwissQueue*) queue;
+
+    if (swissqueue -> head == NULL) {
+        return NULL;
+    }
+
+    return SwissQueue_removeEntry(swissqueue -> head, swissqueue);
+}
+
+static Thread *SwissQueue_removeByID(u16 thread_id, ThreadQueue *queue) {
+    SwissQueue *swissqueue = (SwissQueue*) queue;
+    const int slot = SwissQueue_findSlot(thread_id, swissqueue);
+
+    if (slot == -1) {
+        return NULL;
+    }
+
+    return SwissQueue_removeEntry(swissqueue -> slots[slot], swissqueue);
+}
+
+static Thread *SwissQueue_getByID(u16 thread_id, ThreadQueue *queue) {
+    SwissQueue *swissqueue = (SwissQueue*) queue;
+    const int slot = SwissQueue_findSlot(thread_id, swissqueue);
+    return (slot == -1) ? NULL : swissqueue -> slots[slot] -> t;
+}
+
+static int SwissQueue_contains(u16 thread_id, ThreadQueue *queue) {
+    return (SwissQueue_findSlot(thread_id, (SwissQueue*) queue) != -1);
+}
+
+static int SwissQueue_isEmpty(ThreadQueue *queue) {
+    SwissQueue *swissqueue = (SwissQueue*) queue;
+    return (swissqueue -> _size == 0);
+}
+
+static int SwissQueue_size(ThreadQueue *queue) {
+    SwissQueue *swissqueue = (SwissQueue*) queue;
+    return swissqueue -> _size;
+}
+
+//----------------------------------- ITERATOR FUNCTIONS  -----------------------------------------
+
+static Thread *SwissIterator_next(Iterator *iterator) {
+    Entry *curr = iterator -> currentEntry;
+    iterator -> currentEntry = curr -> next;
+    return curr -> t;
+}
+
+static int SwissIterator_hasNext(Iterator *iterator) {
+    return iterator -> currentEntry != NULL;
+}
+
+static Iterator *new_SwissIterator(ThreadQueue *queue) {
+    SwissQueue *swissqueue = (SwissQueue*) queue;
+    Iterator *iterator = malloc(sizeof(Iterator));
+    if (iterator == NULL) {
+        return NULL;
+    }
+
+    iterator -> hasNext = SwissIterator_hasNext;
+    iterator -> next = SwissIterator_next;
+    iterator -> currentEntry = swissqueue -> head;
+    iterator -> queue = queue;
+    iterator -> remaining = 0;
+
+    return iterator;
+}
+
+//----------------------------------- CONSTRUCTORS + DESTRUCTOR -----------------------------------
+
+static void SwissQueue_free(ThreadQueue *queue) {
+    SwissQueue *swissqueue = (SwissQueue*) queue;
+    EntryPool_free(&(swissqueue -> pool));
+    free(swissqueue -> control);
+    free(swissqueue -> keys);
+    free(swissqueue -> slots);
+    free(swissqueue);
+}
+
+/*
+    - Allocates the three parallel slot arrays, with every control byte empty
+    Returns 0 if any malloc failed, 1 otherwise.
+*/
+static int SwissQueue_allocTable(int capacity, u8 **control, u16 **keys, Entry ***slots) {
+    *control = malloc(capacity * sizeof(u8));
+    *keys = malloc(capacity * sizeof(u16));
+    *slots = calloc(capacity, sizeof(Entry*));
+
+    if (*control == NULL || *keys == NULL || *slots == NULL) {
+        free(*control);
+        free(*keys);
+        free(*slots);
+        return 0;
+    }
+
+    for (int i = 0; i < capacity; ++i) {
+        (*control)[i] = SWISS_EMPTY;
+    }
+    return 1;
+}
+
+/*
+    Returns 0 if any malloc failed, 1 otherwise.
+*/
+int init_SwissQueue(SwissQueue *this) {
+    this -> _size = 0;
+    this -> capacity = INITIAL_CAPACITY;
+    this -> tombstones = 0;
+    this -> head = NULL;
+    this -> tail = NULL;
+
+    if (SwissQueue_allocTable(INITIAL_CAPACITY, &(this -> control), &(this -> keys), &(this -> slots)) == 0) {
+        return 0;
+    }
+
+    if (init_EntryPool(&(this -> pool)) == 0) {
+        free(this -> control);
+        free(this -> keys);
+        free(this -> slots);
+        return 0;
+    }
+
+    this -> dequeue = SwissQueue_dequeue;
+    this -> contains = SwissQueue_contains;
+    this -> enqueue = SwissQueue_enqueue;
+    this -> isEmpty = SwissQueue_isEmpty;
+    this -> removeByID = SwissQueue_removeByID;
+    this -> getByID = SwissQueue_getByID;
+    this -> iterator = new_SwissIterator;
+    this -> size = SwissQueue_size;
+    this -> freeQueue = SwissQueue_free;
+    this -> enqueueBatch = ThreadQueue_enqueueEach;
+    this -> dequeueN = ThreadQueue_dequeueEach;
+    this -> getHash = FNV1AHash;
+
+    return 1;
+}
+
+SwissQueue *new_SwissQueue() {
+    SwissQueue *this = malloc(sizeof(SwissQueue));
+    if (this == NULL) {
+        return NULL;
+    }
+    if (init_SwissQueue(this) == 0) {
+        free(this);
+        return NULL;
+    }
+    return this;
+}
+
+/*
+    - Rebuilds the table at new_capacity, reinserting Entries in FIFO order
+    - Tombstones are dropped, only the table arrays are replaced
+    Returns 0 if the new table could not be allocated (the old table is kept), 1 otherwise.
+*/
+int SwissQueue_rehash(SwissQueue *swissqueue, int new_capacity) {
+    u8 *new_control;
+    u16 *new_keys;
+    Entry **new_slots;
+
+    if (SwissQueue_allocTable(new_capacity, &new_control, &new_keys, &new_slots) == 0) {
+        return 0;
+    }
+
+    swissqueue -> tombstones = 0;
+    for (Entry *curr = swissqueue -> head; curr != NULL; curr = curr -> next) {
+        SwissQueue_place(curr, new_control, new_keys, new_slots, new_capacity, swissqueue);
+    }
+
+    free(swissqueue -> control);
+    free(swissqueue -> keys);
+    free(swissqueue -> slots);
+    swissqueue -> control = new_control;
+    swissqueue -> keys = new_keys;
+    swissqueue -> slots = new_slots;
+    swissqueue -> capacity = new_capacity;
+    return 1;
+}
@@ -0,0 +1,53 @@
+#ifndef SWISS_QUEUE_H
+#define SWISS_QUEUE_H
+
+#include "hash-queue.h"
+
+#define SWISS_GROUP_WIDTH 16                               // slots compared at once, one SSE2 register of control bytes
+#define SWISS_EMPTY ((u8) 0x80)
+#define SWISS_DELETED ((u8) 0xFE)
+#define SWISS_FINGERPRINT_MASK 0x7f                        // full slots store the low 7 hash bits, so their top bit is clear
+
+typedef struct SwissQueue SwissQueue;
+
+/*
+    HashQueue backend using group probing over a control byte array (Swiss table style):
+    - each slot has a control byte, either SWISS_EMPTY, SWISS_DELETED or a 7 bit hash fingerprint
+    - a probe compares a whole group of SWISS_GROUP_WIDTH control bytes at once
+    - thread IDs are kept inline in keys, so contains never touches Entry or Thread memory
+      and getByID only dereferences the Entry it returns
+    - deletion leaves SWISS_DELETED tombstones (unless the group still has an empty slot),
+      which are purged when the table is rebuilt
+*/
+struct SwissQueue {
+    // Common Queue Interface
+    Thread* (*dequeue) (ThreadQueue*);                     // Input: queue. Output: dequeued element
+    int (*contains) (u16, ThreadQueue*);                   // success/failure return value
+    QueueResultPair (*enqueue) (Thread*, ThreadQueue*);    // Inputs: enqueue element, queue. Output: queue pointer, enqueue success/failure
+    int (*isEmpty) (ThreadQueue*);                         // success/failure return value
+    Thread* (*removeByID) (u16, ThreadQueue*);             // Inputs: ID, queue. Output: removed element
+    Thread* (*getByID) (u16, ThreadQueue*);                // Returns a reference to the Thread, but does not remove
+    Iterator* (*iterator)(ThreadQueue*);
+    int (*size) (ThreadQueue*);                            // Returns the number of elements in the SwissQueue
+    void (*freeQueue) (ThreadQueue*);
+    QueueResultPair (*enqueueBatch) (Thread**, int, ThreadQueue*);  // Inputs: elements, count, queue. Output: queue pointer, number enqueued
+    int (*dequeueN) (Thread**, int, ThreadQueue*);                  // Inputs: output array, max count, queue. Output: number dequeued, oldest first
+
+    // Swiss Queue only
+    u32 (*getHash) (u16);
+    int _size;
+    int capacity;                                          // power of 2, at least SWISS_GROUP_WIDTH
+    int tombstones;                                        // SWISS_DELETED control bytes
+    Entry *head;
+    Entry *tail;
+    u8 *control;                                           // capacity control bytes
+    u16 *keys;                                             // thread ID of each full slot
+    Entry **slots;
+    EntryPool pool;
+};
+
+SwissQueue *new_SwissQueue();
+int init_SwissQueue(SwissQueue*);
+int SwissQueue_rehash(SwissQueue*, int new_capacity);
+
+#endif /* SWISS_QUEUE_H */
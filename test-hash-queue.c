@@ -1,11 +1,28 @@
 #include <stdio.h>
 #include <assert.h>
 #include <stdlib.h>
+#include <pthread.h>
 #include "hash-queue.h"
+#include "intrusive-hash-queue.h"
+#include "direct-queue.h"
+#include "swiss-queue.h"
+#include "index-queue.h"
+#include "percpu-queue.h"
+#include "sharded-queue.h"
+#include "priority-queue.h"
 #include "test-hash-queue.h"
 
-static const int test_count = 68;
+// setup() hashes with IDHash, so hq_* lookups must too. A HQ_STATIC_HASH build of hash-queue.c
+// ignores getHash and hashes with the default HQ_HASH, which the inline API then has to share.
+#ifndef HQ_STATIC_HASH
+#define HQ_HASH hq_idHash
+#define HQ_HASH_FN IDHash
+#endif
+#include "hash-queue-inline.h"
+
+static const int test_count = 135;
 static int tests_passed = 0;
+static int tests_skipped = 0;
 
 static ThreadQueue *threadqueue;
 static HashQueue *hashqueue;
@@ -15,20 +32,22 @@ static Thread* overlapping_threads[10];
 static void initialiseOverlappingThreads(void) {
     for (int i = 0; i < 10; ++i) {
         overlapping_threads[i] = malloc(sizeof(Thread));
+        overlapping_threads[i] -> priority = 0;
     }
 
     overlapping_threads[0] -> id = 0;       // hashes to 0, placed at 0
     overlapping_threads[1] -> id = 128;     // hashes to 0, should be placed at 1
     overlapping_threads[2] -> id = 256;     // hashes to 0, should be placed at 2
-    overlapping_threads[3] -> id = 3;       // in place
-    overlapping_threads[4] -> id = 1;       // hashes to 1, should be placed at 4
-    overlapping_threads[5] -> id = 129;     // hashes to 1, should be placed at 5
+    overlapping_threads[3] -> id = 3;       // in place, until displaced to 5 by 1 and 129
+    overlapping_threads[4] -> id = 1;       // hashes to 1, takes slot 3 from 3 (Robin Hood)
+    overlapping_threads[5] -> id = 129;     // hashes to 1, takes slot 4 from 3 (Robin Hood)
 }
 
 static void initialiseBasicThreads(void) {
     for (int i = 0; i < 256; ++i) {
         threads[i] = malloc(sizeof(Thread));
         threads[i] -> id = i;
+        threads[i] -> priority = 0;
     }
 }
 
@@ -64,6 +83,18 @@ static void runTest(void (*testFunction) (void)) {
     teardown();
 }
 
+/*
+    - For tests that check where IDHash puts each Entry, skipped when HQ_STATIC_HASH overrides getHash
+*/
+static void runLayoutTest(void (*testFunction) (void)) {
+#ifdef HQ_STATIC_HASH
+    (void) testFunction;
+    ++tests_skipped;
+#else
+    runTest(testFunction);
+#endif
+}
+
 /*
     Construction Test
     - private fields initialised correctly
@@ -72,7 +103,7 @@ static void runTest(void (*testFunction) (void)) {
 static void constructionTest(void) {
     assert(hashqueue -> _size == 0);
     assert(hashqueue -> capacity == INITIAL_CAPACITY);
-    assert(hashqueue -> load_factor == 0.0);
+    assert(HashQueue_loadFactor(hashqueue) == 0.0);
     assert(hashqueue -> table != NULL);
     assert(hashqueue -> head == NULL);
     assert(hashqueue -> tail == NULL);
@@ -91,8 +122,8 @@ static void sizeModified(void) {
     assert(threadqueue -> size(threadqueue) == 1);                  // size is 1
     assert(threadqueue -> isEmpty(threadqueue) == 0);               // queue not empty
 
-    assert(hashqueue -> load_factor != 0);                          // load factor has changed
-    assert(hashqueue -> load_factor == (double) 1 / hashqueue -> capacity);
+    assert(HashQueue_loadFactor(hashqueue) != 0);                          // load factor has changed
+    assert(HashQueue_loadFactor(hashqueue) == (double) 1 / hashqueue -> capacity);
 
     ++tests_passed;
 }
@@ -168,7 +199,7 @@ static void insert3(void) {
     hashqueue = (HashQueue*) threadqueue;
 
     assert(hashqueue -> _size == 3);
-    assert(hashqueue -> load_factor == (double) 3 / INITIAL_CAPACITY);
+    assert(HashQueue_loadFactor(hashqueue) == (double) 3 / INITIAL_CAPACITY);
 
     assert(hashqueue -> head -> next -> t == threads[1]);   // head next OK
     assert(hashqueue -> tail -> prev -> t == threads[1]);   // tail prev OK
@@ -187,7 +218,18 @@ static void insert3(void) {
     ++tests_passed;
 }
 
-static void linearProbing(void) {
+/*
+    Robin Hood probing: an entry further from its ideal slot takes the slot of a richer occupant
+
+    Slot    thread_id   probe distance
+    0       0           0
+    1       128         1
+    2       256         2
+    3       1           2
+    4       129         3
+    5       3           2
+*/
+static void robinHoodProbing(void) {
     QueueResultPair result;
     for (int i = 0; i < 6; ++i) {
         result = threadqueue -> enqueue(overlapping_threads[i], threadqueue);
@@ -196,12 +238,13 @@ static void linearProbing(void) {
 
     hashqueue = (HashQueue*) threadqueue;
 
-    assert(hashqueue -> table[0] -> t -> id == 0);
-    assert(hashqueue -> table[1] -> t -> id == 128);
-    assert(hashqueue -> table[2] -> t -> id == 256);
-    assert(hashqueue -> table[3] -> t -> id == 3);
-    assert(hashqueue -> table[4] -> t -> id == 1);
-    assert(hashqueue -> table[5] -> t -> id == 129);
+    const u16 expected_ids[6] = {0, 128, 256, 1, 129, 3};
+    const u32 expected_distances[6] = {0, 1, 2, 2, 3, 2};
+    for (int i = 0; i < 6; ++i) {
+        assert(hashqueue -> table[i] -> t -> id == expected_ids[i]);
+        assert(hashqueue -> table[i] -> table_index == (u32) i);
+        assert(hashqueue -> slots[i].probe_distance == expected_distances[i]);
+    }
 
     ++tests_passed;
 }
@@ -250,12 +293,12 @@ static void dequeueSizesChanged(void) {
         threadqueue = result.queue;
     }
 
-    double old_load_factor = hashqueue -> load_factor;
+    double old_load_factor = HashQueue_loadFactor(hashqueue);
     int old_size = hashqueue -> _size;
     Thread *dequeued = threadqueue -> dequeue(threadqueue);
     hashqueue = (HashQueue*) threadqueue;
 
-    assert(hashqueue -> load_factor != old_load_factor);
+    assert(HashQueue_loadFactor(hashqueue) != old_load_factor);
     assert(hashqueue -> _size == old_size - 1);
 
     ++tests_passed;
@@ -324,15 +367,16 @@ static void dequeueTableMended(void) {
     0       0
     1       128
     2       256
-    3       3
-    4       1
-    5       129
+    3       1
+    4       129
+    5       3
 
-    After dequeueing Thread with id 0, we expect 4 deletion restorations to take place:
+    After dequeueing Thread with id 0, every displaced entry shifts back by one:
     -   Thread id 128 (slot 1) should move to slot 0 (just vacated by id 0)
-    -   Thread id 256 (slot 2) should move to slot 1 (just vacated by id 128)
-    -   Thread id 1 (slot 4) should move to slot 2 (just vacated by id 256)
-    -   Thread id 129 (slot 5) should move to slot 4 (just vacated by id 1)
+    -   Thread id 256 (slot 2) should move to slot 1
+    -   Thread id 1 (slot 3) should move to slot 2
+    -   Thread id 129 (slot 4) should move to slot 3
+    -   Thread id 3 (slot 5) should move to slot 4
     -   slot 5 should be empty
 */
 static void dequeueTableRepairTest(void) {
@@ -354,14 +398,15 @@ static void dequeueTableRepairTest(void) {
     assert(hashqueue -> table[1] -> t -> id == 256);        // id 256 moved to slot 1
     assert(hashqueue -> table[1] -> table_index == 1);
 
-    assert(hashqueue -> table[2] -> t -> id == 1);          // id 129 moved to slot 4
+    assert(hashqueue -> table[2] -> t -> id == 1);          // id 1 moved to slot 2
     assert(hashqueue -> table[2] -> table_index == 2);
 
-    assert(hashqueue -> table[3] -> t -> id == 3);          // id 3 did not move
+    assert(hashqueue -> table[3] -> t -> id == 129);        // id 129 moved to slot 3
     assert(hashqueue -> table[3] -> table_index == 3);
 
-    assert(hashqueue -> table[4] -> t -> id == 129);        // id 128 moved to slot 0
+    assert(hashqueue -> table[4] -> t -> id == 3);          // id 3 moved to slot 4
     assert(hashqueue -> table[4] -> table_index == 4);
+    assert(hashqueue -> slots[4].probe_distance == 1);   // one step closer to its ideal slot
 
     assert(hashqueue -> table[5] == NULL);                  // slot 5 is empty
 
@@ -413,7 +458,7 @@ static void dequeueTableIndicesUpdated(void) {
 
     // All threads shifted down
     for (int i = 0; i < 7; ++i) {
-        assert(hashqueue -> table[i] -> table_index == i);
+        assert(hashqueue -> table[i] -> table_index == (u32) i);
         assert(hashqueue -> table[i] -> t -> id == i);
     }
 
@@ -466,9 +511,9 @@ static void removeByIDLoadFactorChanged(void) {
 
     hashqueue = (HashQueue*) threadqueue;
 
-    assert(hashqueue -> load_factor == (double) 10 / INITIAL_CAPACITY);
+    assert(HashQueue_loadFactor(hashqueue) == (double) 10 / INITIAL_CAPACITY);
     threadqueue -> removeByID(0, threadqueue);
-    assert(hashqueue -> load_factor == (double) 9 / INITIAL_CAPACITY);
+    assert(HashQueue_loadFactor(hashqueue) == (double) 9 / INITIAL_CAPACITY);
 
     ++tests_passed;
 }
@@ -598,15 +643,16 @@ static void removeByIDTailTableAmended(void) {
     0       0
     1       128
     2       256
-    3       3
-    4       1
-    5       129
+    3       1
+    4       129
+    5       3
 
     If we remove id 128, we should expect:
 
     -   Thread id 256 (slot 2) should move to slot 1 (just vacated by id 128)
-    -   Thread id 1 (slot 4) should move to slot 2 (just vacated by id 256)
-    -   Thread id 129 (slot 5) should move to slot 4 (just vacated by id 1)
+    -   Thread id 1 (slot 3) should move to slot 2
+    -   Thread id 129 (slot 4) should move to slot 3
+    -   Thread id 3 (slot 5) should move to slot 4
     -   slot 5 should be empty
 
 */
@@ -624,13 +670,13 @@ static void removeByIDTableRepairTest(void) {
     assert(hashqueue -> table[1] -> t -> id == 256);        // id 256 moved to slot 1
     assert(hashqueue -> table[1] -> table_index == 1);
 
-    assert(hashqueue -> table[2] -> t -> id == 1);          // id 129 moved to slot 4
+    assert(hashqueue -> table[2] -> t -> id == 1);          // id 1 moved to slot 2
     assert(hashqueue -> table[2] -> table_index == 2);
 
-    assert(hashqueue -> table[3] -> t -> id == 3);          // id 3 did not move
+    assert(hashqueue -> table[3] -> t -> id == 129);        // id 129 moved to slot 3
     assert(hashqueue -> table[3] -> table_index == 3);
 
-    assert(hashqueue -> table[4] -> t -> id == 129);        // id 128 moved to slot 0
+    assert(hashqueue -> table[4] -> t -> id == 3);          // id 3 moved to slot 4
     assert(hashqueue -> table[4] -> table_index == 4);
 
     assert(hashqueue -> table[5] == NULL);                  // slot 5 is empty
@@ -640,10 +686,11 @@ static void removeByIDTableRepairTest(void) {
 
 /*
     Enqueueing 124, 252, 380, 508, 0, 636 should give:
+    (636 is 4 slots from its ideal slot, so it takes slot 0 from 0)
 
         Table slot  | Thread ID
-            0           0
-            1           636
+            0           636
+            1           0
 
             125         124
             126         252
@@ -695,8 +742,8 @@ static void removeByIDTableRepairWrapAround(void) {
     threadqueue = result.queue;
 
 
-    assert(hashqueue -> table[0] -> t -> id == 0);
-    assert(hashqueue -> table[1] -> t -> id == 636);
+    assert(hashqueue -> table[0] -> t -> id == 636);
+    assert(hashqueue -> table[1] -> t -> id == 0);
     assert(hashqueue -> table[124] -> t -> id == 124);
     assert(hashqueue -> table[125] -> t -> id == 252);
     assert(hashqueue -> table[126] -> t -> id == 380);
@@ -707,6 +754,7 @@ static void removeByIDTableRepairWrapAround(void) {
     /*
         508 moves into slot 126, vacated by removed Thread 380
         636 moves into slot 127, (wrapped back around), vacated by 508
+        0 moves back into its ideal slot 0, vacated by 636
     */
     assert(hashqueue -> table[0] -> t -> id == 0);
     assert(hashqueue -> table[1] == NULL);
@@ -760,10 +808,11 @@ static void removeByIDDuplicateIDs(void) {
     }
     hashqueue = (HashQueue*) threadqueue;
 
+    // The second 0 displaces 1 and 2, which are closer to their ideal slots
     assert(hashqueue -> table[0] -> t -> id == 0);
-    assert(hashqueue -> table[1] -> t -> id == 1);
-    assert(hashqueue -> table[2] -> t -> id == 2);
-    assert(hashqueue -> table[3] -> t -> id == 0);
+    assert(hashqueue -> table[1] -> t -> id == 0);
+    assert(hashqueue -> table[2] -> t -> id == 1);
+    assert(hashqueue -> table[3] -> t -> id == 2);
 
     threadqueue -> removeByID(0, threadqueue);
 
@@ -870,19 +919,29 @@ static void removeByIDTableIndicesUpdated2(void) {
     }
     hashqueue = (HashQueue*) threadqueue;
 
+    /*
+        Before
+        Slot    ID
+        0       0
+        1       128
+        2       1
+        3       129
+        4       2
+        5       133
+    */
     threadqueue -> removeByID(0, threadqueue);
     
     assert(hashqueue -> table[0] -> t -> id == 128);        // moved
     assert(hashqueue -> table[0] -> table_index == 0);      // and index updated
 
-    assert(hashqueue -> table[1] -> t -> id == 1);
+    assert(hashqueue -> table[1] -> t -> id == 1);          // moved
     assert(hashqueue -> table[1] -> table_index == 1);
 
-    assert(hashqueue -> table[2] -> t -> id == 2);
-    assert(hashqueue -> table[2] -> table_index == 2);
+    assert(hashqueue -> table[2] -> t -> id == 129);        // moved
+    assert(hashqueue -> table[2] -> table_index == 2);      // and index updated
 
-    assert(hashqueue -> table[3] -> t -> id == 129);        // moved
-    assert(hashqueue -> table[3] -> table_index == 3);      // and index updated
+    assert(hashqueue -> table[3] -> t -> id == 2);          // moved
+    assert(hashqueue -> table[3] -> table_index == 3);
 
     assert(hashqueue -> table[4] == NULL);
 
@@ -914,10 +973,12 @@ static void removeByIDCorrectLocationsAndPointers(void) {
     test_threads[4] -> id = 2;
 
     /*
+        255 takes slot 0 from 0, which moves on to slot 2
+
         Slot    ID
-        0       0
+        0       255
         1       128
-        2       255 
+        2       0 
         3       2
         127     127
     */
@@ -930,13 +991,13 @@ static void removeByIDCorrectLocationsAndPointers(void) {
 
 
 
-    assert(hashqueue -> table[0] -> t -> id == 0);
+    assert(hashqueue -> table[0] -> t -> id == 255);
     assert(hashqueue -> table[0] -> table_index == 0);
 
     assert(hashqueue -> table[1] -> t -> id == 128);
     assert(hashqueue -> table[1] -> table_index == 1);
 
-    assert(hashqueue -> table[2] -> t -> id == 255);
+    assert(hashqueue -> table[2] -> t -> id == 0);
     assert(hashqueue -> table[2] -> table_index == 2);
 
     assert(hashqueue -> table[3] -> t -> id == 2);
@@ -957,8 +1018,8 @@ static void removeByIDCorrectLocationsAndPointers(void) {
 
         /*
         Slot    ID
-        0       0
-        1       128
+        0       128
+        1       0
         2       2 
         3       
         127     255
@@ -967,10 +1028,10 @@ static void removeByIDCorrectLocationsAndPointers(void) {
     assert(rem_prev -> next == rem_next);
     assert(rem_next -> prev == rem_prev);
 
-    assert(hashqueue -> table[0] -> t -> id == 0);
+    assert(hashqueue -> table[0] -> t -> id == 128);
     assert(hashqueue -> table[0] -> table_index == 0);
 
-    assert(hashqueue -> table[1] -> t -> id == 128);
+    assert(hashqueue -> table[1] -> t -> id == 0);
     assert(hashqueue -> table[1] -> table_index == 1);
 
     assert(hashqueue -> table[2] -> t -> id == 2);
@@ -1110,7 +1171,10 @@ static void containsContiguousBlockTest(void) {
     }
     hashqueue = (HashQueue*) threadqueue;
 
-    assert(hashqueue -> table[0] -> t -> id == 253);
+    // 253 takes slot 126, pushing 126 to 127 and 127 round to 0
+    assert(hashqueue -> table[126] -> t -> id == 253);
+    assert(hashqueue -> table[127] -> t -> id == 126);
+    assert(hashqueue -> table[0] -> t -> id == 127);
 
     threadqueue -> removeByID(126, threadqueue);
 
@@ -1148,7 +1212,7 @@ static void noRehashBeforeThreshold(void) {
     ++tests_passed;
 }
 
-static void addressModifiedAfterRehash(void) {
+static void addressUnmodifiedAfterRehash(void) {
     ThreadQueue* original_queue_address = threadqueue;
 
     QueueResultPair result;
@@ -1160,7 +1224,8 @@ static void addressModifiedAfterRehash(void) {
     result = threadqueue -> enqueue(threads[64], threadqueue);
     threadqueue = result.queue;
 
-    assert(original_queue_address != threadqueue);
+    assert(original_queue_address == threadqueue);      // only the table is reallocated
+    assert(hashqueue -> capacity == INITIAL_CAPACITY * 2);
 
     ++tests_passed;
 }
@@ -1275,7 +1340,7 @@ static void rehashTableFieldsUpdated(void) {
 
     int old_size = hashqueue -> _size;
     int old_capacity = hashqueue -> capacity;
-    double old_load_factor = hashqueue -> load_factor;
+    double old_load_factor = HashQueue_loadFactor(hashqueue);
 
     // Add 1 more element, forcing rehashing
     result = threadqueue -> enqueue(test_threads[64], threadqueue);
@@ -1285,7 +1350,7 @@ static void rehashTableFieldsUpdated(void) {
 
     int new_size = hashqueue -> _size;
     int new_capacity = hashqueue -> capacity;
-    double new_load_factor = hashqueue -> load_factor;
+    double new_load_factor = HashQueue_loadFactor(hashqueue);
     
 
     assert(new_size == old_size + 1);
@@ -1645,105 +1710,1983 @@ static void iteratorExampleUsage(void) {
     ++tests_passed;
 }
 
-void runAllTests(void) {
-    // Setup global test variables
-    initialiseBasicThreads();
-    initialiseOverlappingThreads();
+static void cursorExampleUsage(void) {
+    for (int i = 0; i < 8; ++i) {
+        threadqueue -> enqueue(threads[i], threadqueue);
+    }
 
-    // Construction Test
-    runTest(constructionTest);
+    HashQueueCursor cursor;
+    init_HashQueueCursor(&cursor, hashqueue);
 
-    // Enqueue tests
-    runTest(sizeModified);
-    runTest(queuePointersUpdatedFirstInsertion);
-    runTest(tableUpdatedFirstInsertion);
-    runTest(addressUnmodified);
-    runTest(enqueueSuccessfulReturnValue);
-    runTest(queuePointersUpdatedSecondInsertion);
-    runTest(insert3);
-    runTest(linearProbing);
+    int idx = 0;
+    while (HashQueueCursor_hasNext(&cursor)) {
+        assert(HashQueueCursor_next(&cursor) == threads[idx]);
+        ++idx;
+    }
+    assert(idx == 8);
 
-    
-    // Size tests
-    runTest(sizeEmpty);
-    runTest(sizeNonEmpty);
-    runTest(sizeMatchesPrivateField);
+    ++tests_passed;
+}
 
-    // Dequeue tests
-    runTest(dequeueSizesChanged);
-    runTest(dequeueEmptyFails);
-    runTest(dequeueCorrectElement);
-    runTest(dequeuePointersMended);
-    runTest(dequeueTableMended);
-    runTest(dequeueTableRepairTest);
-    runTest(dequeueLoneElementQPointersAmended);
-    runTest(dequeueTableIndicesUpdated);
+static void forEachVisitsFIFO(void) {
+    Thread *pos;
+    int idx = 0;
 
-    // removeByID tests
-    runTest(removeByIDCorrectElement);
-    runTest(removeByIDSizeChanged);
-    runTest(removeByIDLoadFactorChanged);
-    runTest(removeByIDNotFound);
-    runTest(removeByIDIntermediatePointersMended);
-    runTest(removeByIDIntermediateTableAmended);
-    runTest(removeByIDHeadPointersAmended);
-    runTest(removeByIDHeadTableAmended);
-    runTest(removeByIDTailPointersAmended);
-    runTest(removeByIDTailTableAmended);
-    runTest(removeByIDTableRepairTest);
-    runTest(removeByIDTableRepairWrapAround);
-    runTest(removeByIDLoneElement);
-    runTest(removeByIDDuplicateIDs);
-    runTest(removeByIDTableIndicesUpdated1);
-    runTest(removeByIDTableIndicesUpdated2);
+    hashqueue_for_each(pos, hashqueue) {
+        ++idx;                                  // empty queue, never entered
+    }
+    assert(idx == 0);
 
-    // GetByID tests
-    runTest(getByIDFalseReturnsNull);
-    runTest(getByIDReturnsCorrect);
-    runTest(getByIDNoModifications);
-    runTest(getByIDTwiceSameElementFound);
-    runTest(getByIDDuplicateElemsSameFound);
-    runTest(removeByIDCorrectLocationsAndPointers);
+    for (int i = 0; i < 8; ++i) {
+        threadqueue -> enqueue(threads[i], threadqueue);
+    }
+    threadqueue -> removeByID(3, threadqueue);
 
-    // Contains tests
-    runTest(containsTrue);
-    runTest(containsFalse);
-    runTest(containsFalseAfterDequeue);
-    runTest(containsFalseAfterRemoveByID);
-    runTest(containsContiguousBlockTest);
+    const int expected[7] = {0, 1, 2, 4, 5, 6, 7};
+    hashqueue_for_each(pos, hashqueue) {
+        assert(pos == threads[expected[idx]]);
+        ++idx;
+    }
+    assert(idx == 7);
 
-    // Rehashing tests
-    runTest(noRehashBeforeThreshold);
-    runTest(addressModifiedAfterRehash);
-    runTest(newTableQPointersCorrect);
-    runTest(correctRehashLocations);
-    runTest(rehashTableFieldsUpdated);
-    runTest(rehashFullChainMaintained);
+    ++tests_passed;
+}
 
-    // isEmpty tests
-    runTest(isEmptyTrue);
-    runTest(isEmptyFalse);
-    runTest(isEmptyFollowingDequeues);
-    runTest(isEmptyFollowingRemoveByIDs);
-    runTest(isEmptyPointersAgreePositive);
-    runTest(isEmptyPointersAgreeNegative);
-    
-    // Table repair tests
-    runTest(tableRepairNoMoveTest1);
-    runTest(tableRepairNoMoveTest2);
-    runTest(tableRepairNoMoveTest3);
+static void forEachEntryVisitsFIFO(void) {
+    Entry *entry;
+    int idx = 0;
 
-    // Iterator tests
-    runTest(constructIteratorTest);
-    runTest(iteratorHasNextTrue);
-    runTest(iteratorHasNextEmptyFalse);
-    runTest(iteratorHasNextDoesNotModify);
-    runTest(iteratorCorrectNext);
-    runTest(iteratorExampleUsage);
-    
-    freeThreads();
-    
-    printf("Passed %u/%u tests.\n", tests_passed, test_count);
+    for (int i = 0; i < 8; ++i) {
+        threadqueue -> enqueue(threads[i], threadqueue);
+    }
+
+    hashqueue_for_each_entry(entry, hashqueue) {
+        assert(entry -> t == threads[idx]);
+        assert(hashqueue -> table[entry -> table_index] == entry);
+        ++idx;
+    }
+    assert(idx == 8);
+
+    ++tests_passed;
+}
+
+/*
+    Entry pool tests
+*/
+
+static void poolInitialised(void) {
+    assert(hashqueue -> pool.slabs != NULL);
+    assert(hashqueue -> pool.free_list != NULL);
+
+    ++tests_passed;
+}
+
+static void poolRecyclesEntries(void) {
+    QueueResultPair result = threadqueue -> enqueue(threads[0], threadqueue);
+    threadqueue = result.queue;
+    hashqueue = (HashQueue*) threadqueue;
+
+    Entry *first_entry = hashqueue -> head;
+    threadqueue -> dequeue(threadqueue);
+    assert(hashqueue -> pool.free_list == first_entry);     // released Entry sits on top of the free list
+
+    result = threadqueue -> enqueue(threads[1], threadqueue);
+    threadqueue = result.queue;
+    hashqueue = (HashQueue*) threadqueue;
+
+    assert(hashqueue -> head == first_entry);               // and is handed straight back out
+    assert(hashqueue -> head -> t == threads[1]);
+
+    ++tests_passed;
+}
+
+static void poolSurvivesRehash(void) {
+    QueueResultPair result;
+    for (int i = 0; i < 64; ++i) {
+        result = threadqueue -> enqueue(threads[i], threadqueue);
+        threadqueue = result.queue;
+    }
+    hashqueue = (HashQueue*) threadqueue;
+    EntrySlab *original_slabs = hashqueue -> pool.slabs;
+
+    result = threadqueue -> enqueue(threads[64], threadqueue);  // forces rehash
+    threadqueue = result.queue;
+    hashqueue = (HashQueue*) threadqueue;
+
+    assert(hashqueue -> pool.slabs == original_slabs);
+
+    // Entries released after the rehash are recycled by the new queue
+    Entry *head = hashqueue -> head;
+    threadqueue -> dequeue(threadqueue);
+    assert(hashqueue -> pool.free_list == head);
+
+    ++tests_passed;
+}
+
+/*
+    Intrusive HashQueue tests
+*/
+
+static void intrusiveFIFOThroughThreadList(void) {
+    IntrusiveHashQueue *intrusive = new_IntrusiveHashQueue();
+    ThreadQueue *queue = (ThreadQueue*) intrusive;
+    intrusive -> getHash = IDHash;
+
+    for (int i = 0; i < 3; ++i) {
+        queue -> enqueue(threads[i], queue);
+    }
+
+    // FIFO is chained through the Threads themselves
+    assert(intrusive -> fifo.next == &(threads[0] -> thread_list));
+    assert(threads[0] -> thread_list.next == &(threads[1] -> thread_list));
+    assert(threads[2] -> thread_list.next == &(intrusive -> fifo));
+
+    // and each Thread knows its table slot
+    for (int i = 0; i < 3; ++i) {
+        assert(intrusive -> table[threads[i] -> queue_index] == threads[i]);
+    }
+
+    for (int i = 0; i < 3; ++i) {
+        assert(queue -> dequeue(queue) == threads[i]);
+    }
+    assert(queue -> isEmpty(queue) == 1);
+    assert(queue -> dequeue(queue) == NULL);
+
+    queue -> freeQueue(queue);
+    ++tests_passed;
+}
+
+static void intrusiveRemoveByIDTableRepair(void) {
+    IntrusiveHashQueue *intrusive = new_IntrusiveHashQueue();
+    ThreadQueue *queue = (ThreadQueue*) intrusive;
+    intrusive -> getHash = IDHash;
+
+    for (int i = 0; i < 6; ++i) {
+        queue -> enqueue(overlapping_threads[i], queue);
+    }
+
+    assert(queue -> removeByID(128, queue) == overlapping_threads[1]);
+    assert(queue -> contains(128, queue) == 0);
+    assert(queue -> size(queue) == 5);
+
+    // Same repaired layout as removeByIDTableRepairTest
+    assert(intrusive -> table[1] -> id == 256);
+    assert(intrusive -> table[2] -> id == 1);
+    assert(intrusive -> table[3] -> id == 3);
+    assert(intrusive -> table[4] -> id == 129);
+    assert(intrusive -> table[5] == NULL);
+    for (int i = 0; i < 5; ++i) {
+        assert(intrusive -> table[i] -> queue_index == (u32) i);
+    }
+
+    // removed Thread is left self-linked
+    assert(list_empty(&(overlapping_threads[1] -> thread_list)));
+    assert(overlapping_threads[0] -> thread_list.next == &(overlapping_threads[2] -> thread_list));
+
+    queue -> freeQueue(queue);
+    ++tests_passed;
+}
+
+static void intrusiveRehashAddressStable(void) {
+    IntrusiveHashQueue *intrusive = new_IntrusiveHashQueue();
+    ThreadQueue *queue = (ThreadQueue*) intrusive;
+    QueueResultPair result;
+
+    for (int i = 0; i < 65; ++i) {
+        result = queue -> enqueue(threads[i], queue);
+        assert(result.queue == queue);
+    }
+    assert(intrusive -> capacity == INITIAL_CAPACITY * 2);
+
+    for (int i = 0; i < 65; ++i) {
+        assert(queue -> getByID(i, queue) == threads[i]);
+    }
+    for (int i = 0; i < 65; ++i) {
+        assert(queue -> dequeue(queue) == threads[i]);
+    }
+
+    queue -> freeQueue(queue);
+    ++tests_passed;
+}
+
+static void intrusiveIterator(void) {
+    IntrusiveHashQueue *intrusive = new_IntrusiveHashQueue();
+    ThreadQueue *queue = (ThreadQueue*) intrusive;
+
+    for (int i = 0; i < 8; ++i) {
+        queue -> enqueue(threads[i], queue);
+    }
+
+    Iterator *it = queue -> iterator(queue);
+    int idx = 0;
+    while (it -> hasNext(it)) {
+        assert(it -> next(it) == threads[idx]);
+        ++idx;
+    }
+    assert(idx == 8);
+
+    free(it);
+    queue -> freeQueue(queue);
+    ++tests_passed;
+}
+
+/*
+    DirectQueue tests
+*/
+
+static void directIndexedByID(void) {
+    DirectQueue *directqueue = new_DirectQueue();
+    ThreadQueue *queue = (ThreadQueue*) directqueue;
+
+    for (int i = 0; i < 6; ++i) {
+        queue -> enqueue(overlapping_threads[i], queue);
+    }
+
+    // IDs which collide in a 128 slot table land in their own slots
+    for (int i = 0; i < 6; ++i) {
+        const u16 id = overlapping_threads[i] -> id;
+        assert(directqueue -> index[id] -> t == overlapping_threads[i]);
+        assert(queue -> getByID(id, queue) == overlapping_threads[i]);
+    }
+    assert(queue -> contains(42, queue) == 0);
+
+    queue -> freeQueue(queue);
+    ++tests_passed;
+}
+
+static void directDuplicateRejected(void) {
+    DirectQueue *directqueue = new_DirectQueue();
+    ThreadQueue *queue = (ThreadQueue*) directqueue;
+
+    QueueResultPair result = queue -> enqueue(threads[7], queue);
+    assert(result.result == 1);
+    assert(result.queue == queue);
+
+    result = queue -> enqueue(threads[7], queue);
+    assert(result.result == 0);
+    assert(queue -> size(queue) == 1);
+
+    queue -> freeQueue(queue);
+    ++tests_passed;
+}
+
+static void directRemoveByIDKeepsOrder(void) {
+    DirectQueue *directqueue = new_DirectQueue();
+    ThreadQueue *queue = (ThreadQueue*) directqueue;
+
+    for (int i = 0; i < 10; ++i) {
+        queue -> enqueue(threads[i], queue);
+    }
+
+    assert(queue -> removeByID(0, queue) == threads[0]);    // head
+    assert(queue -> removeByID(5, queue) == threads[5]);    // intermediate
+    assert(queue -> removeByID(9, queue) == threads[9]);    // tail
+    assert(queue -> removeByID(9, queue) == NULL);
+    assert(directqueue -> index[5] == NULL);
+    assert(queue -> size(queue) == 7);
+
+    const int expected[7] = {1, 2, 3, 4, 6, 7, 8};
+    for (int i = 0; i < 7; ++i) {
+        assert(queue -> dequeue(queue) -> id == expected[i]);
+    }
+    assert(directqueue -> head == NULL);
+    assert(directqueue -> tail == NULL);
+
+    queue -> freeQueue(queue);
+    ++tests_passed;
+}
+
+/*
+    Incremental rehash tests
+*/
+
+static void incrementalRehashDefersMigration(void) {
+    hashqueue -> incremental_rehash = 1;
+
+    for (int i = 0; i < 65; ++i) {
+        threadqueue -> enqueue(threads[i], threadqueue);
+    }
+
+    // Table doubled, but the Entries have not been moved yet
+    assert(hashqueue -> capacity == INITIAL_CAPACITY * 2);
+    assert(hashqueue -> old_table != NULL);
+    assert(hashqueue -> old_capacity == INITIAL_CAPACITY);
+    assert(HashQueue_loadFactor(hashqueue) == (double) 65 / (INITIAL_CAPACITY * 2));
+
+    // Lookups consult both tables
+    for (int i = 0; i < 65; ++i) {
+        assert(threadqueue -> getByID(i, threadqueue) == threads[i]);
+    }
+    assert(threadqueue -> contains(65, threadqueue) == 0);
+
+    ++tests_passed;
+}
+
+static void incrementalRehashCompletes(void) {
+    hashqueue -> incremental_rehash = 1;
+
+    for (int i = 0; i < 65; ++i) {
+        threadqueue -> enqueue(threads[i], threadqueue);
+    }
+
+    // Each operation migrates a bounded number of Entries
+    threadqueue -> enqueue(threads[65], threadqueue);
+    assert(hashqueue -> old_table != NULL);
+
+    for (int i = 66; i < 80; ++i) {
+        threadqueue -> enqueue(threads[i], threadqueue);
+    }
+    assert(hashqueue -> old_table == NULL);
+
+    // Every Entry now sits in the doubled table, at the index it believes it is at
+    for (int i = 0; i < 80; ++i) {
+        Entry *entry = hashqueue -> getEntryByID(i, threadqueue);
+        assert(hashqueue -> table[entry -> table_index] == entry);
+    }
+
+    // and FIFO order is untouched
+    for (int i = 0; i < 80; ++i) {
+        assert(threadqueue -> dequeue(threadqueue) == threads[i]);
+    }
+
+    ++tests_passed;
+}
+
+static void incrementalRehashRemoveFromOldTable(void) {
+    hashqueue -> incremental_rehash = 1;
+
+    for (int i = 0; i < 65; ++i) {
+        threadqueue -> enqueue(threads[i], threadqueue);
+    }
+
+    // IDs near the end of the old table are migrated last
+    assert(threadqueue -> removeByID(60, threadqueue) == threads[60]);
+    assert(threadqueue -> contains(60, threadqueue) == 0);
+    assert(threadqueue -> dequeue(threadqueue) == threads[0]);
+    assert(threadqueue -> size(threadqueue) == 63);
+
+    for (int i = 1; i < 65; ++i) {
+        if (i != 60) {
+            assert(threadqueue -> getByID(i, threadqueue) == threads[i]);
+        }
+    }
+
+    // Drain through the migration
+    for (int i = 1; i < 65; ++i) {
+        if (i != 60) {
+            assert(threadqueue -> dequeue(threadqueue) == threads[i]);
+        }
+    }
+    assert(hashqueue -> old_table == NULL);
+    assert(threadqueue -> isEmpty(threadqueue) == 1);
+
+    ++tests_passed;
+}
+
+static void resizeFinishesLongMigration(void) {
+    // at load 0.05 the old table is mostly empty slots, more than one visit budget can cover
+    HashQueue *hq = new_HashQueue_with(1000, 0.05);
+    hq -> incremental_rehash = 1;
+    Thread *local[4000];
+    int count = 0;
+
+    while (hq -> old_table == NULL) {
+        local[count] = malloc(sizeof(Thread));
+        local[count] -> id = count;
+        hq -> enqueue(local[count], (ThreadQueue*) hq);
+        ++ count;
+    }
+
+    assert(HashQueue_reserve(4000, hq) == 1);
+    assert(hq -> old_table == NULL);
+    for (int i = 0; i < count; ++i) {
+        assert(hq -> dequeue((ThreadQueue*) hq) == local[i]);
+    }
+    for (int i = 0; i < count; ++i) {
+        assert(hq -> contains(i, (ThreadQueue*) hq) == 0);
+        free(local[i]);
+    }
+
+    hq -> freeQueue((ThreadQueue*) hq);
+    ++tests_passed;
+}
+
+/*
+    Shrink tests
+*/
+
+static void shrinkBelowLowWaterMark(void) {
+    for (int i = 0; i < 65; ++i) {
+        threadqueue -> enqueue(threads[i], threadqueue);
+    }
+    assert(hashqueue -> capacity == INITIAL_CAPACITY * 2);
+
+    // Hold at 32 / 256 == SHRINK_THRESHOLD
+    for (int i = 0; i < 33; ++i) {
+        threadqueue -> dequeue(threadqueue);
+    }
+    assert(hashqueue -> capacity == INITIAL_CAPACITY * 2);
+
+    // 31 / 256 crosses the low-water mark
+    threadqueue -> removeByID(64, threadqueue);
+    assert(hashqueue -> capacity == INITIAL_CAPACITY);
+    assert(HashQueue_loadFactor(hashqueue) == (double) 31 / INITIAL_CAPACITY);
+
+    for (int i = 33; i < 64; ++i) {
+        Entry *entry = hashqueue -> getEntryByID(i, threadqueue);
+        assert(entry -> t == threads[i]);
+        assert(hashqueue -> table[entry -> table_index] == entry);
+    }
+    for (int i = 33; i < 64; ++i) {
+        assert(threadqueue -> dequeue(threadqueue) == threads[i]);
+    }
+
+    ++tests_passed;
+}
+
+static void shrinkStopsAtInitialCapacity(void) {
+    for (int i = 0; i < 4; ++i) {
+        threadqueue -> enqueue(threads[i], threadqueue);
+    }
+    for (int i = 0; i < 4; ++i) {
+        threadqueue -> dequeue(threadqueue);
+    }
+
+    assert(hashqueue -> capacity == INITIAL_CAPACITY);
+    assert(HashQueue_shrink(hashqueue) == 0);
+
+    ++tests_passed;
+}
+
+static void shrinkDisabled(void) {
+    HashQueue_setShrinkThreshold(0.0, hashqueue);
+
+    for (int i = 0; i < 65; ++i) {
+        threadqueue -> enqueue(threads[i], threadqueue);
+    }
+    for (int i = 0; i < 65; ++i) {
+        threadqueue -> dequeue(threadqueue);
+    }
+
+    assert(hashqueue -> capacity == INITIAL_CAPACITY * 2);
+
+    ++tests_passed;
+}
+
+/*
+    Sizing tests
+*/
+
+static void withSizesTableForHint(void) {
+    HashQueue *hq = new_HashQueue_with(200, 0.0);      // 0.0 keeps REHASH_THRESHOLD
+    assert(hq -> capacity == 512);
+    assert(hq -> max_load == REHASH_THRESHOLD);
+
+    for (int i = 0; i < 200; ++i) {
+        hq -> enqueue(threads[i], (ThreadQueue*) hq);
+    }
+    assert(hq -> capacity == 512);
+
+    hq -> freeQueue((ThreadQueue*) hq);
+    ++tests_passed;
+}
+
+static void withSmallHintAndMaxLoad(void) {
+    HashQueue *hq = new_HashQueue_with(3, 0.75);
+    assert(hq -> capacity == MIN_CAPACITY);
+
+    for (int i = 0; i < 3; ++i) {
+        hq -> enqueue(threads[i], (ThreadQueue*) hq);
+    }
+    assert(hq -> capacity == MIN_CAPACITY);
+    hq -> enqueue(threads[3], (ThreadQueue*) hq);
+    assert(hq -> capacity == MIN_CAPACITY * 2);
+
+    // shrinks back to the sized capacity, and no further
+    for (int i = 0; i < 4; ++i) {
+        assert(hq -> dequeue((ThreadQueue*) hq) == threads[i]);
+    }
+    assert(hq -> capacity == MIN_CAPACITY);
+    assert(HashQueue_shrink(hq) == 0);
+
+    hq -> freeQueue((ThreadQueue*) hq);
+    ++tests_passed;
+}
+
+static void limitsFollowCapacity(void) {
+    assert(hashqueue -> grow_at == INITIAL_CAPACITY / 2);
+    assert(hashqueue -> shrink_at == INITIAL_CAPACITY / 8);
+
+    for (int i = 0; i < 65; ++i) {
+        threadqueue -> enqueue(threads[i], threadqueue);
+    }
+    assert(hashqueue -> grow_at == INITIAL_CAPACITY);
+    assert(hashqueue -> shrink_at == INITIAL_CAPACITY / 4);
+    assert(HashQueue_loadFactor(hashqueue) == (double) 65 / (INITIAL_CAPACITY * 2));
+
+    HashQueue_setShrinkThreshold(0.0, hashqueue);
+    assert(hashqueue -> shrink_at == 0);
+
+    ++tests_passed;
+}
+
+static void limitsRoundLikeDivision(void) {
+    // 4 * 0.3 = 1.2 Threads, so the second enqueue grows the table, as 2 / 4 > 0.3 would
+    HashQueue *hq = new_HashQueue_with(0, 0.3);
+    assert(hq -> capacity == MIN_CAPACITY);
+    assert(hq -> grow_at == 1);
+
+    hq -> enqueue(threads[0], (ThreadQueue*) hq);
+    assert(hq -> capacity == MIN_CAPACITY);
+    hq -> enqueue(threads[1], (ThreadQueue*) hq);
+    assert(hq -> capacity == MIN_CAPACITY * 2);
+    assert(hq -> grow_at == 2);
+
+    // 8 * 0.075 = 0.6, so only an empty table is below the shrink threshold
+    assert(hq -> shrink_at == 1);
+
+    hq -> freeQueue((ThreadQueue*) hq);
+    ++tests_passed;
+}
+
+static void tinyMaxLoadStopsAtMaxCapacity(void) {
+    // a full queue would need 2^16 / 1e-9 slots
+    assert(new_HashQueue_with(MAX_THREADS, 1e-9) == NULL);
+
+    // one Thread at 1e-6 takes 10^6 slots, the largest table allowed
+    HashQueue *hq = new_HashQueue_with(1, 1e-6);
+    assert(hq -> capacity == MAX_CAPACITY);
+    assert(HashQueue_reserve(2, hq) == 0);
+
+    // growth past MAX_CAPACITY fails, but the Threads are still queued
+    assert(hq -> enqueue(threads[0], (ThreadQueue*) hq).result == 1);
+    assert(hq -> enqueue(threads[1], (ThreadQueue*) hq).result == 1);
+    assert(hq -> capacity == MAX_CAPACITY);
+    assert(hq -> dequeue((ThreadQueue*) hq) == threads[0]);
+    assert(hq -> dequeue((ThreadQueue*) hq) == threads[1]);
+
+    hq -> freeQueue((ThreadQueue*) hq);
+    ++tests_passed;
+}
+
+static void reserveGrowsOnceAndHolds(void) {
+    assert(HashQueue_reserve(200, hashqueue) == 1);
+    assert(hashqueue -> capacity == 512);
+
+    for (int i = 0; i < 200; ++i) {
+        threadqueue -> enqueue(threads[i], threadqueue);
+    }
+    assert(hashqueue -> capacity == 512);
+
+    for (int i = 0; i < 200; ++i) {
+        assert(threadqueue -> dequeue(threadqueue) == threads[i]);
+    }
+    assert(hashqueue -> capacity == 512);
+
+    // smaller reservations change nothing
+    assert(HashQueue_reserve(10, hashqueue) == 1);
+    assert(hashqueue -> capacity == 512);
+
+    ++tests_passed;
+}
+
+/*
+    Slot array tests
+*/
+
+static void assertSlotsMirrorTable(HashQueue *hashqueue) {
+    for (int i = 0; i < hashqueue -> capacity; ++i) {
+        if (hashqueue -> table[i] == NULL) {
+            assert(hashqueue -> slots[i].probe_distance == SLOT_EMPTY);
+        } else {
+            assert(hashqueue -> slots[i].id == hashqueue -> table[i] -> t -> id);
+            assert(hashqueue -> slots[i].probe_distance != SLOT_EMPTY);
+        }
+    }
+}
+
+static void slotsMirrorTable(void) {
+    for (int i = 0; i < 6; ++i) {
+        threadqueue -> enqueue(overlapping_threads[i], threadqueue);
+    }
+    assertSlotsMirrorTable(hashqueue);
+
+    // backward shift moves ids and distances along with the Entries
+    threadqueue -> removeByID(128, threadqueue);
+    assertSlotsMirrorTable(hashqueue);
+    assert(hashqueue -> slots[1].id == 256);
+    assert(hashqueue -> slots[1].probe_distance == 1);
+
+    threadqueue -> dequeue(threadqueue);
+    assertSlotsMirrorTable(hashqueue);
+
+    ++tests_passed;
+}
+
+static void slotsMirrorTableAfterRehash(void) {
+    for (int i = 0; i < 65; ++i) {
+        threadqueue -> enqueue(threads[i], threadqueue);
+    }
+    assert(hashqueue -> capacity == INITIAL_CAPACITY * 2);
+    assertSlotsMirrorTable(hashqueue);
+
+    for (int i = 0; i < 65; ++i) {
+        assert(threadqueue -> contains(i, threadqueue));
+    }
+
+    ++tests_passed;
+}
+
+/*
+    Wakeup inbox tests
+*/
+
+static void inboxDrainedOnDequeue(void) {
+    HashQueue_post(threads[4], hashqueue);
+    HashQueue_post(threads[5], hashqueue);
+    HashQueue_post(threads[6], hashqueue);
+
+    // posted Threads are invisible until drained
+    assert(threadqueue -> size(threadqueue) == 0);
+    assert(threadqueue -> contains(4, threadqueue) == 0);
+
+    assert(threadqueue -> dequeue(threadqueue) == threads[4]);     // posting order is kept
+    assert(threadqueue -> size(threadqueue) == 2);
+    assert(atomic_load(&(hashqueue -> inbox)) == NULL);
+
+    // already queued Threads stay ahead of newly posted ones
+    HashQueue_post(threads[7], hashqueue);
+    assert(threadqueue -> dequeue(threadqueue) == threads[5]);
+    assert(threadqueue -> dequeue(threadqueue) == threads[6]);
+    assert(threadqueue -> dequeue(threadqueue) == threads[7]);
+    assert(threadqueue -> dequeue(threadqueue) == NULL);
+
+    ++tests_passed;
+}
+
+#define INBOX_PRODUCERS 4
+#define INBOX_POSTS 1000
+
+static Thread inbox_threads[INBOX_PRODUCERS * INBOX_POSTS];
+
+static void *inboxProducer(void *arg) {
+    const int producer = (int) (long) arg;
+    for (int i = 0; i < INBOX_POSTS; ++i) {
+        HashQueue_post(&inbox_threads[producer * INBOX_POSTS + i], hashqueue);
+    }
+    return NULL;
+}
+
+static void inboxConcurrentProducers(void) {
+    pthread_t producers[INBOX_PRODUCERS];
+    int next_expected[INBOX_PRODUCERS] = {0};
+
+    for (int i = 0; i < INBOX_PRODUCERS * INBOX_POSTS; ++i) {
+        inbox_threads[i].id = i;
+    }
+    for (int p = 0; p < INBOX_PRODUCERS; ++p) {
+        pthread_create(&producers[p], NULL, inboxProducer, (void*) (long) p);
+    }
+
+    // consume while producers are still posting, each producer's Threads arrive in order
+    int received = 0;
+    while (received < INBOX_PRODUCERS * INBOX_POSTS) {
+        Thread *t = threadqueue -> dequeue(threadqueue);
+        if (t == NULL) {
+            continue;
+        }
+        const int producer = t -> id / INBOX_POSTS;
+        assert(t -> id % INBOX_POSTS == next_expected[producer]);
+        ++ next_expected[producer];
+        ++ received;
+    }
+
+    for (int p = 0; p < INBOX_PRODUCERS; ++p) {
+        pthread_join(producers[p], NULL);
+    }
+    assert(threadqueue -> isEmpty(threadqueue));
+
+    ++tests_passed;
+}
+
+/*
+    Batch enqueue tests
+*/
+
+static void enqueueBatchGrowsOnce(void) {
+    QueueResultPair result = threadqueue -> enqueueBatch(threads, 200, threadqueue);
+    assert(result.result == 200);
+    assert(result.queue == threadqueue);
+
+    // straight to the capacity 200 Entries need, 128 -> 512
+    assert(hashqueue -> capacity == INITIAL_CAPACITY * 4);
+    assert(HashQueue_loadFactor(hashqueue) == (double) 200 / (INITIAL_CAPACITY * 4));
+    assert(threadqueue -> size(threadqueue) == 200);
+
+    for (int i = 0; i < 200; ++i) {
+        Entry *entry = hashqueue -> getEntryByID(i, threadqueue);
+        assert(entry -> t == threads[i]);
+        assert(hashqueue -> table[entry -> table_index] == entry);
+    }
+
+    ++tests_passed;
+}
+
+static void enqueueBatchAppendsToTail(void) {
+    threadqueue -> enqueue(threads[100], threadqueue);
+    threadqueue -> enqueue(threads[101], threadqueue);
+
+    assert(threadqueue -> enqueueBatch(threads, 10, threadqueue).result == 10);
+    assert(threadqueue -> enqueueBatch(threads, 0, threadqueue).result == 0);
+    assert(hashqueue -> tail -> t == threads[9]);
+    assert(hashqueue -> tail -> next == NULL);
+
+    assert(threadqueue -> dequeue(threadqueue) == threads[100]);
+    assert(threadqueue -> dequeue(threadqueue) == threads[101]);
+    for (int i = 0; i < 10; ++i) {
+        assert(threadqueue -> dequeue(threadqueue) == threads[i]);
+    }
+    assert(hashqueue -> head == NULL);
+
+    ++tests_passed;
+}
+
+static void enqueueBatchAllBackends(void) {
+    ThreadQueue *queues[6] = {
+        (ThreadQueue*) new_IntrusiveHashQueue(),
+        (ThreadQueue*) new_DirectQueue(),
+        (ThreadQueue*) new_SwissQueue(),
+        (ThreadQueue*) new_IndexQueue(),
+        (ThreadQueue*) new_ShardedQueue(),
+        (ThreadQueue*) new_PriorityQueue()
+    };
+
+    for (int q = 0; q < 6; ++q) {
+        ThreadQueue *queue = queues[q];
+        queue -> enqueue(threads[200], queue);
+        assert(queue -> enqueueBatch(threads, 150, queue).result == 150);
+        assert(queue -> size(queue) == 151);
+
+        assert(queue -> dequeue(queue) == threads[200]);
+        for (int i = 0; i < 150; ++i) {
+            assert(queue -> dequeue(queue) == threads[i]);
+        }
+        queue -> freeQueue(queue);
+    }
+
+    ++tests_passed;
+}
+
+/*
+    Batch dequeue tests
+
+    Dequeueing 0, 128 and 256 from the robinHoodProbing layout leaves a single repaired cluster
+
+    Slot    thread_id   probe distance
+    0       -           -
+    1       1           0
+    2       129         1
+    3       3           0
+*/
+static void dequeueNRepairsCluster(void) {
+    Thread *out[6];
+    for (int i = 0; i < 6; ++i) {
+        threadqueue -> enqueue(overlapping_threads[i], threadqueue);
+    }
+
+    assert(threadqueue -> dequeueN(out, 3, threadqueue) == 3);
+    for (int i = 0; i < 3; ++i) {
+        assert(out[i] == overlapping_threads[i]);
+    }
+    assert(threadqueue -> size(threadqueue) == 3);
+    assert(hashqueue -> head -> t == overlapping_threads[3]);
+    assert(hashqueue -> head -> prev == NULL);
+
+    const u16 expected_ids[3] = {1, 129, 3};
+    const u32 expected_distances[3] = {0, 1, 0};
+    assert(hashqueue -> table[0] == NULL);
+    assert(hashqueue -> slots[0].probe_distance == SLOT_EMPTY);
+    for (int i = 1; i < 4; ++i) {
+        assert(hashqueue -> table[i] -> t -> id == expected_ids[i - 1]);
+        assert(hashqueue -> table[i] -> table_index == (u32) i);
+        assert(hashqueue -> slots[i].probe_distance == expected_distances[i - 1]);
+    }
+    assert(hashqueue -> table[4] == NULL);
+    assert(hashqueue -> table[5] == NULL);
+
+    ++tests_passed;
+}
+
+static void dequeueNStopsWhenEmpty(void) {
+    Thread *out[20];
+    assert(threadqueue -> dequeueN(out, 20, threadqueue) == 0);
+
+    for (int i = 0; i < 10; ++i) {
+        threadqueue -> enqueue(threads[i], threadqueue);
+    }
+    assert(threadqueue -> dequeueN(out, 0, threadqueue) == 0);
+    assert(threadqueue -> dequeueN(out, 20, threadqueue) == 10);
+    for (int i = 0; i < 10; ++i) {
+        assert(out[i] == threads[i]);
+        assert(threadqueue -> contains(i, threadqueue) == 0);
+    }
+    assert(hashqueue -> head == NULL);
+    assert(hashqueue -> tail == NULL);
+    assert(HashQueue_loadFactor(hashqueue) == 0.0);
+
+    ++tests_passed;
+}
+
+static void dequeueNAllBackends(void) {
+    Thread *out[150];
+    ThreadQueue *queues[6] = {
+        (ThreadQueue*) new_IntrusiveHashQueue(),
+        (ThreadQueue*) new_DirectQueue(),
+        (ThreadQueue*) new_SwissQueue(),
+        (ThreadQueue*) new_IndexQueue(),
+        (ThreadQueue*) new_ShardedQueue(),
+        (ThreadQueue*) new_PriorityQueue()
+    };
+
+    for (int q = 0; q < 6; ++q) {
+        ThreadQueue *queue = queues[q];
+        queue -> enqueueBatch(threads, 150, queue);
+
+        assert(queue -> dequeueN(out, 100, queue) == 100);
+        assert(queue -> dequeueN(out + 100, 100, queue) == 50);
+        for (int i = 0; i < 150; ++i) {
+            assert(out[i] == threads[i]);
+        }
+        assert(queue -> isEmpty(queue));
+        queue -> freeQueue(queue);
+    }
+
+    ++tests_passed;
+}
+
+/*
+    Bulk removal tests
+
+    Removing 128, 1 and 3 from the robinHoodProbing layout
+
+    Slot    thread_id   probe distance
+    0       0           0
+    1       256         1
+    2       129         1
+*/
+static void removeByIDsRepairsClusters(void) {
+    u32 ids[ID_BITMAP_WORDS] = {0};
+    for (int i = 0; i < 6; ++i) {
+        threadqueue -> enqueue(overlapping_threads[i], threadqueue);
+    }
+
+    ID_BITMAP_SET(ids, 128);
+    ID_BITMAP_SET(ids, 1);
+    ID_BITMAP_SET(ids, 3);
+    ID_BITMAP_SET(ids, 4000);                                   // not queued
+    assert(HashQueue_removeByIDs(ids, hashqueue) == 3);
+    assert(threadqueue -> size(threadqueue) == 3);
+
+    const u16 expected_ids[3] = {0, 256, 129};
+    const u32 expected_distances[3] = {0, 1, 1};
+    for (int i = 0; i < 3; ++i) {
+        assert(hashqueue -> table[i] -> t -> id == expected_ids[i]);
+        assert(hashqueue -> table[i] -> table_index == (u32) i);
+        assert(hashqueue -> slots[i].probe_distance == expected_distances[i]);
+    }
+    for (int i = 3; i < 6; ++i) {
+        assert(hashqueue -> table[i] == NULL);
+    }
+
+    // FIFO order of the survivors is unchanged
+    assert(threadqueue -> dequeue(threadqueue) -> id == 0);
+    assert(threadqueue -> dequeue(threadqueue) -> id == 256);
+    assert(threadqueue -> dequeue(threadqueue) -> id == 129);
+    assert(hashqueue -> tail == NULL);
+
+    ++tests_passed;
+}
+
+static void removeByIDsManyIDs(void) {
+    u32 ids[ID_BITMAP_WORDS] = {0};
+    for (int i = 0; i < 200; ++i) {
+        threadqueue -> enqueue(threads[i], threadqueue);
+    }
+    threadqueue -> enqueue(threads[7], threadqueue);             // duplicate
+
+    for (int i = 0; i < 200; i += 2) {
+        ID_BITMAP_SET(ids, i);
+    }
+    ID_BITMAP_SET(ids, 7);
+    assert(HashQueue_removeByIDs(ids, hashqueue) == 102);
+    assert(threadqueue -> size(threadqueue) == 99);
+
+    for (int i = 0; i < 200; ++i) {
+        assert(threadqueue -> contains(i, threadqueue) == (i % 2 == 1 && i != 7));
+    }
+    for (int i = 1; i < 200; i += 2) {
+        if (i != 7) {
+            assert(threadqueue -> dequeue(threadqueue) == threads[i]);
+        }
+    }
+    assert(threadqueue -> isEmpty(threadqueue));
+
+    ++tests_passed;
+}
+
+/*
+    Filtered removal tests
+*/
+
+static int idAtLeast(Thread *t, void *ctx) {
+    return t -> id >= *(u16*) ctx;
+}
+
+static int idOdd(Thread *t, void *ctx) {
+    (void) ctx;
+    return t -> id & 1;
+}
+
+static void removeIfEvictsMatching(void) {
+    for (int i = 0; i < 6; ++i) {
+        threadqueue -> enqueue(overlapping_threads[i], threadqueue);
+    }
+
+    // removes 128, 256 and 129, leaving 0, 3 and 1 in FIFO order
+    u16 threshold = 128;
+    assert(HashQueue_removeIf(idAtLeast, &threshold, hashqueue) == 3);
+    assert(threadqueue -> size(threadqueue) == 3);
+
+    const u16 expected_ids[3] = {0, 3, 1};
+    for (int i = 0; i < 3; ++i) {
+        Entry *entry = hashqueue -> getEntryByID(expected_ids[i], threadqueue);
+        assert(hashqueue -> table[entry -> table_index] == entry);
+        assert(threadqueue -> dequeue(threadqueue) -> id == expected_ids[i]);
+    }
+    assert(hashqueue -> head == NULL);
+    assert(hashqueue -> tail == NULL);
+
+    ++tests_passed;
+}
+
+static void removeIfManyThreads(void) {
+    for (int i = 0; i < 200; ++i) {
+        threadqueue -> enqueue(threads[i], threadqueue);
+    }
+
+    assert(HashQueue_removeIf(idOdd, NULL, hashqueue) == 100);
+    assert(HashQueue_removeIf(idOdd, NULL, hashqueue) == 0);
+    assert(threadqueue -> size(threadqueue) == 100);
+
+    for (int i = 0; i < 200; ++i) {
+        assert(threadqueue -> contains(i, threadqueue) == (i % 2 == 0));
+    }
+    for (int i = 0; i < 200; i += 2) {
+        assert(threadqueue -> dequeue(threadqueue) == threads[i]);
+    }
+
+    ++tests_passed;
+}
+
+static void forEachSafeRemoval(void) {
+    Entry *entry;
+    Entry *n;
+
+    for (int i = 0; i < 10; ++i) {
+        threadqueue -> enqueue(threads[i], threadqueue);
+    }
+
+    hashqueue_for_each_entry_safe(entry, n, hashqueue) {
+        if (entry -> t -> id % 3 == 0) {
+            threadqueue -> removeByID(entry -> t -> id, threadqueue);
+        }
+    }
+
+    const int expected[6] = {1, 2, 4, 5, 7, 8};
+    for (int i = 0; i < 6; ++i) {
+        assert(threadqueue -> dequeue(threadqueue) == threads[expected[i]]);
+    }
+    assert(threadqueue -> isEmpty(threadqueue));
+
+    ++tests_passed;
+}
+
+/*
+    Hash function tests
+*/
+
+static void fnv1aHashesBothOctets(void) {
+    // FNV-1a over the two bytes of the ID, low byte first
+    for (u32 id = 0; id < MAX_THREADS; id += 257) {
+        u32 expected = FNV_32_OFFSET_BASIS;
+        expected = (expected ^ (id & 0xff)) * FNV_32_PRIME;
+        expected = (expected ^ (id >> 8)) * FNV_32_PRIME;
+        assert(FNV1AHash(id) == expected);
+    }
+
+    ++tests_passed;
+}
+
+static void hashFamilyUsableAsGetHash(void) {
+    u32 (*hashes[3]) (u16) = {FibonacciHash, MurmurHash, XorShiftHash};
+
+    for (int h = 0; h < 3; ++h) {
+        HashQueue *hq = new_HashQueue();
+        hq -> getHash = hashes[h];
+
+        for (int i = 0; i < 256; ++i) {
+            hq -> enqueue(threads[i], (ThreadQueue*) hq);
+        }
+        for (int i = 0; i < 256; i += 2) {
+            assert(hq -> removeByID(i, (ThreadQueue*) hq) == threads[i]);
+        }
+        for (int i = 0; i < 256; ++i) {
+            assert(hq -> contains(i, (ThreadQueue*) hq) == (i % 2 == 1));
+        }
+        for (int i = 1; i < 256; i += 2) {
+            assert(hq -> dequeue((ThreadQueue*) hq) == threads[i]);
+        }
+
+        hq -> freeQueue((ThreadQueue*) hq);
+    }
+
+    ++tests_passed;
+}
+
+/*
+    Statistics tests
+*/
+
+static void statsRecordProbesAndRepairs(void) {
+    for (int i = 0; i < 6; ++i) {
+        threadqueue -> enqueue(overlapping_threads[i], threadqueue);
+    }
+    HashQueue_resetStats(hashqueue);
+
+    assert(threadqueue -> contains(256, threadqueue));              // found 2 slots past its ideal slot
+    assert(threadqueue -> removeByID(128, threadqueue) != NULL);    // 256, 1, 129 and 3 shift back
+    HashQueueStats stats = HashQueue_getStats(hashqueue);
+
+#ifdef HASHQUEUE_STATS
+    assert(stats.lookup.count == 2);
+    assert(stats.lookup.histogram[2] == 1);
+    assert(stats.lookup.histogram[1] == 1);
+    assert(stats.lookup.max == 3);
+    assert(stats.repair_moves == 4);
+    assert(stats.insert.count == 0);
+#else
+    assert(stats.lookup.count == 0);
+    assert(stats.repair_moves == 0);
+#endif
+
+    ++tests_passed;
+}
+
+static void statsCountRehashes(void) {
+    for (int i = 0; i < 65; ++i) {
+        threadqueue -> enqueue(threads[i], threadqueue);
+    }
+    assert(HashQueue_shrink(hashqueue) == 1);
+    HashQueueStats stats = HashQueue_getStats(hashqueue);
+
+#ifdef HASHQUEUE_STATS
+    assert(stats.rehashes == 1);
+    assert(stats.shrinks == 1);
+    assert(stats.insert.count == 65 * 3);                           // enqueued, then placed by both resizes
+    u64 histogram_total = 0;
+    for (int i = 0; i < STATS_PROBE_BUCKETS; ++i) {
+        histogram_total += stats.insert.histogram[i];
+    }
+    assert(histogram_total == stats.insert.count);
+#else
+    assert(stats.rehashes == 0);
+    assert(stats.insert.count == 0);
+#endif
+
+    ++tests_passed;
+}
+
+/*
+    PriorityQueue tests
+*/
+
+static void priorityDequeueHighestFirst(void) {
+    ThreadQueue *queue = (ThreadQueue*) new_PriorityQueue();
+    PriorityQueue *priorityqueue = (PriorityQueue*) queue;
+
+    // levels 5, 0, 63 and past the last level, which shares level 63
+    const u8 priorities[8] = {5, 0, 63, 5, 200, 0, 63, 5};
+    for (int i = 0; i < 8; ++i) {
+        threads[i] -> priority = priorities[i];
+        assert(queue -> enqueue(threads[i], queue).result == 1);
+    }
+    assert(queue -> enqueue(threads[3], queue).result == 0);
+    assert(priorityqueue -> nonempty == (((u64) 1 << 0) | ((u64) 1 << 5) | ((u64) 1 << 63)));
+
+    const int expected[8] = {1, 5, 0, 3, 7, 2, 4, 6};
+    for (int i = 0; i < 8; ++i) {
+        assert(queue -> dequeue(queue) == threads[expected[i]]);
+    }
+    assert(queue -> dequeue(queue) == NULL);
+    assert(priorityqueue -> nonempty == 0);
+
+    for (int i = 0; i < 8; ++i) {
+        threads[i] -> priority = 0;
+    }
+    queue -> freeQueue(queue);
+    ++tests_passed;
+}
+
+static void priorityRemoveAndReprioritise(void) {
+    ThreadQueue *queue = (ThreadQueue*) new_PriorityQueue();
+    PriorityQueue *priorityqueue = (PriorityQueue*) queue;
+
+    for (int i = 0; i < 6; ++i) {
+        threads[i] -> priority = (i < 3) ? 10 : 20;
+        queue -> enqueue(threads[i], queue);
+    }
+
+    // emptying level 10 clears its bit
+    for (int i = 0; i < 3; ++i) {
+        assert(queue -> removeByID(i, queue) == threads[i]);
+    }
+    assert(queue -> contains(0, queue) == 0);
+    assert(priorityqueue -> nonempty == (u64) 1 << 20);
+
+    // boosting 5 moves it ahead of 3 and 4
+    assert(PriorityQueue_setPriority(5, 1, priorityqueue) == 1);
+    assert(queue -> getByID(5, queue) == threads[5]);
+
+    // an unqueued ID is left alone, Thread and levels alike
+    assert(PriorityQueue_setPriority(0, 1, priorityqueue) == 0);
+    assert(threads[0] -> priority == 10);
+    assert(queue -> contains(0, queue) == 0);
+    assert(priorityqueue -> nonempty == (((u64) 1 << 1) | ((u64) 1 << 20)));
+
+    assert(queue -> dequeue(queue) == threads[5]);
+    assert(queue -> dequeue(queue) == threads[3]);
+    assert(queue -> size(queue) == 1);
+
+    for (int i = 0; i < 6; ++i) {
+        threads[i] -> priority = 0;
+    }
+    queue -> freeQueue(queue);
+    ++tests_passed;
+}
+
+static void priorityIteratorFollowsDequeueOrder(void) {
+    ThreadQueue *queue = (ThreadQueue*) new_PriorityQueue();
+
+    for (int i = 0; i < 64; ++i) {
+        threads[i] -> priority = 63 - i;
+        queue -> enqueue(threads[i], queue);
+    }
+
+    Iterator *iterator = queue -> iterator(queue);
+    for (int i = 63; i >= 0; --i) {
+        assert(iterator -> hasNext(iterator));
+        assert(iterator -> next(iterator) == threads[i]);
+    }
+    assert(iterator -> hasNext(iterator) == 0);
+    free(iterator);
+
+    for (int i = 0; i < 64; ++i) {
+        threads[i] -> priority = 0;
+    }
+    queue -> freeQueue(queue);
+    ++tests_passed;
+}
+
+/*
+    Inline API tests
+*/
+
+static void inlineLookupMatchesVtable(void) {
+    hashqueue -> incremental_rehash = 1;
+
+    // 65 Entries start a migration, so lookups have to check old_table too
+    for (int i = 0; i < 65; ++i) {
+        assert(hq_enqueue(hashqueue, threads[i]) == 1);
+    }
+    assert(hashqueue -> old_table != NULL);
+    assert(hq_removeByID(hashqueue, 10) == threads[10]);
+
+    for (int i = 0; i < 100; ++i) {
+        assert(hq_getByID(hashqueue, i) == threadqueue -> getByID(i, threadqueue));
+        assert(hq_contains(hashqueue, i) == threadqueue -> contains(i, threadqueue));
+    }
+    assert(hq_size(hashqueue) == threadqueue -> size(threadqueue));
+    assert(hq_isEmpty(hashqueue) == threadqueue -> isEmpty(threadqueue));
+
+    ++tests_passed;
+}
+
+static void inlineKeepsFIFO(void) {
+    for (int i = 0; i < 6; ++i) {
+        hq_enqueue(hashqueue, overlapping_threads[i]);
+    }
+    assert(hq_removeByID(hashqueue, 128) == overlapping_threads[1]);
+    assert(hq_removeByID(hashqueue, 128) == NULL);
+
+    const u16 expected_ids[5] = {0, 256, 3, 1, 129};
+    for (int i = 0; i < 5; ++i) {
+        assert(hq_dequeue(hashqueue) -> id == expected_ids[i]);
+    }
+    assert(hq_dequeue(hashqueue) == NULL);
+    assert(hq_isEmpty(hashqueue));
+
+    ++tests_passed;
+}
+
+static void inlineNewUsesSelectedHash(void) {
+    HashQueue *hq = hq_new();
+    assert(hq -> getHash == HQ_HASH_FN);
+
+    for (int i = 0; i < 100; ++i) {
+        hq_enqueue(hq, threads[i]);
+    }
+    for (int i = 0; i < 100; ++i) {
+        assert(hq_getByID(hq, i) == threads[i]);
+    }
+    assert(hq_contains(hq, 100) == 0);
+
+    hq -> freeQueue((ThreadQueue*) hq);
+    ++tests_passed;
+}
+
+/*
+    Optimistic reader tests
+*/
+
+static void readLookupMatchesGetByID(void) {
+    hashqueue -> incremental_rehash = 1;
+
+    // 65 Entries start a migration, leaving most of them in old_table
+    for (int i = 0; i < 65; ++i) {
+        threadqueue -> enqueue(threads[i], threadqueue);
+    }
+    assert(hashqueue -> old_table != NULL);
+    threadqueue -> removeByID(10, threadqueue);
+
+    for (int i = 0; i < 100; ++i) {
+        assert(HashQueue_readGetByID(i, hashqueue) == threadqueue -> getByID(i, threadqueue));
+        assert(HashQueue_readContains(i, hashqueue) == threadqueue -> contains(i, threadqueue));
+    }
+    assert((atomic_load(&(hashqueue -> seq)) & 1) == 0);
+
+    ++tests_passed;
+}
+
+static void retiredTableWaitsForReaders(void) {
+    atomic_store(&(hashqueue -> readers), 1);                  // a lookup is in progress on another CPU
+
+    Entry **old_table = hashqueue -> table;
+    for (int i = 0; i < 65; ++i) {
+        threadqueue -> enqueue(threads[i], threadqueue);
+    }
+    assert(hashqueue -> table != old_table);
+    assert(hashqueue -> retired != NULL);
+    assert(hashqueue -> retired -> table == old_table);
+
+    // the next write after the reader leaves frees it
+    atomic_store(&(hashqueue -> readers), 0);
+    threadqueue -> dequeue(threadqueue);
+    assert(hashqueue -> retired == NULL);
+
+    ++tests_passed;
+}
+
+static _Atomic int reader_stop;
+
+/*
+    - IDs 0-9 stay queued throughout, IDs above 250 are never queued
+*/
+static void *optimisticReader(void *arg) {
+    (void) arg;
+    while (atomic_load(&reader_stop) == 0) {
+        for (int i = 0; i < 10; ++i) {
+            assert(HashQueue_readGetByID(i, hashqueue) == threads[i]);
+        }
+        assert(HashQueue_readContains(251, hashqueue) == 0);
+    }
+    return NULL;
+}
+
+static void readersDuringRehash(void) {
+    pthread_t reader;
+
+    for (int i = 0; i < 10; ++i) {
+        threadqueue -> enqueue(threads[i], threadqueue);
+    }
+    atomic_store(&reader_stop, 0);
+    pthread_create(&reader, NULL, optimisticReader, NULL);
+
+    // grow and shrink repeatedly, in both rehash modes, while the reader probes
+    for (int round = 0; round < 50; ++round) {
+        hashqueue -> incremental_rehash = round & 1;
+        for (int i = 10; i < 250; ++i) {
+            threadqueue -> enqueue(threads[i], threadqueue);
+        }
+        for (int i = 10; i < 250; ++i) {
+            threadqueue -> removeByID(i, threadqueue);
+        }
+    }
+
+    atomic_store(&reader_stop, 1);
+    pthread_join(reader, NULL);
+    assert(threadqueue -> size(threadqueue) == 10);
+
+    ++tests_passed;
+}
+
+/*
+    - IDs 0-9 stay queued throughout, any other ID found must map to its own Thread
+*/
+static void *churnReader(void *arg) {
+    (void) arg;
+    while (atomic_load(&reader_stop) == 0) {
+        for (int i = 0; i < 250; ++i) {
+            Thread *t = HashQueue_readGetByID(i, hashqueue);
+            assert(t == threads[i] || (i >= 10 && t == NULL));
+        }
+    }
+    return NULL;
+}
+
+static void readersDuringChurn(void) {
+    pthread_t readers[2];
+
+    for (int i = 0; i < 10; ++i) {
+        threadqueue -> enqueue(threads[i], threadqueue);
+    }
+    atomic_store(&reader_stop, 0);
+    for (int r = 0; r < 2; ++r) {
+        pthread_create(&readers[r], NULL, churnReader, NULL);
+    }
+
+    // batch enqueues and tombstoning removals retire tables under the readers, in both rehash modes
+    for (int round = 0; round < 50; ++round) {
+        hashqueue -> incremental_rehash = round & 1;
+        threadqueue -> enqueueBatch(threads + 10, 240, threadqueue);
+        for (int i = 249; i >= 130; --i) {
+            threadqueue -> removeByID(i, threadqueue);
+        }
+        for (int i = 10; i < 130; ++i) {
+            threadqueue -> removeByID(i, threadqueue);
+        }
+    }
+
+    atomic_store(&reader_stop, 1);
+    for (int r = 0; r < 2; ++r) {
+        pthread_join(readers[r], NULL);
+    }
+    assert(threadqueue -> size(threadqueue) == 10);
+    assert(hashqueue -> readers == 0);
+
+    ++tests_passed;
+}
+
+/*
+    Per-CPU queue tests
+*/
+
+static void percpuRemoveFindsRemoteThread(void) {
+    PerCPUQueues *percpu = new_PerCPUQueues(4);
+
+    for (int i = 0; i < 8; ++i) {
+        assert(PerCPU_enqueue(threads[i], i % 4, percpu) == 1);
+    }
+    assert(PerCPU_enqueue(threads[5], 0, percpu) == 0);             // already queued on CPU 1
+    assert(percpu -> owner[5] == 1);
+
+    assert(PerCPU_contains(6, percpu) == 1);
+    assert(PerCPU_removeByID(6, percpu) == threads[6]);
+    assert(PerCPU_contains(6, percpu) == 0);
+    assert(PerCPU_removeByID(6, percpu) == NULL);
+    assert(percpu -> cpus[2].queue -> _size == 1);
+
+    assert(PerCPU_dequeue(1, percpu) == threads[1]);
+    assert(percpu -> owner[1] == PERCPU_NO_CPU);
+
+    PerCPUQueues_free(percpu);
+    ++tests_passed;
+}
+
+static void percpuStealTakesTailBatch(void) {
+    PerCPUQueues *percpu = new_PerCPUQueues(2);
+
+    for (int i = 0; i < 10; ++i) {
+        PerCPU_enqueue(threads[i], 0, percpu);
+    }
+
+    // CPU 1 is idle, so it steals half of CPU 0's newest Threads and runs the oldest of them
+    assert(PerCPU_dequeue(1, percpu) == threads[5]);
+    assert(percpu -> cpus[0].queue -> _size == 5);
+    for (int i = 6; i < 10; ++i) {
+        assert(percpu -> owner[i] == 1);
+    }
+    assert(PerCPU_removeByID(8, percpu) == threads[8]);
+
+    for (int i = 0; i < 5; ++i) {
+        assert(PerCPU_dequeue(0, percpu) == threads[i]);
+    }
+    assert(PerCPU_dequeue(1, percpu) == threads[6]);
+    assert(PerCPU_dequeue(1, percpu) == threads[7]);
+    assert(PerCPU_dequeue(1, percpu) == threads[9]);
+    assert(PerCPU_dequeue(1, percpu) == NULL);
+
+    PerCPUQueues_free(percpu);
+    ++tests_passed;
+}
+
+#define PERCPU_TEST_CPUS 4
+#define PERCPU_TEST_THREADS 4000
+
+static PerCPUQueues *percpu_shared;
+static Thread percpu_threads[PERCPU_TEST_THREADS];
+static _Atomic int percpu_seen[PERCPU_TEST_THREADS];
+static _Atomic int percpu_done;
+
+/*
+    - CPU 0 produces every Thread, the others only run what they steal
+*/
+static void *percpuWorker(void *arg) {
+    const int cpu = (int) (long) arg;
+
+    if (cpu == 0) {
+        for (int i = 0; i < PERCPU_TEST_THREADS; ++i) {
+            assert(PerCPU_enqueue(&percpu_threads[i], 0, percpu_shared) == 1);
+        }
+    }
+
+    while (atomic_load(&percpu_done) < PERCPU_TEST_THREADS) {
+        Thread *t = PerCPU_dequeue(cpu, percpu_shared);
+        if (t != NULL) {
+            assert(atomic_fetch_add(&percpu_seen[t -> id], 1) == 0);
+            atomic_fetch_add(&percpu_done, 1);
+        }
+    }
+    return NULL;
+}
+
+static void percpuConcurrentStealing(void) {
+    pthread_t cpus[PERCPU_TEST_CPUS];
+    percpu_shared = new_PerCPUQueues(PERCPU_TEST_CPUS);
+    atomic_store(&percpu_done, 0);
+
+    for (int i = 0; i < PERCPU_TEST_THREADS; ++i) {
+        percpu_threads[i].id = i;
+        atomic_store(&percpu_seen[i], 0);
+    }
+    for (int cpu = 0; cpu < PERCPU_TEST_CPUS; ++cpu) {
+        pthread_create(&cpus[cpu], NULL, percpuWorker, (void*) (long) cpu);
+    }
+    for (int cpu = 0; cpu < PERCPU_TEST_CPUS; ++cpu) {
+        pthread_join(cpus[cpu], NULL);
+    }
+
+    // every Thread ran exactly once
+    for (int i = 0; i < PERCPU_TEST_THREADS; ++i) {
+        assert(atomic_load(&percpu_seen[i]) == 1);
+        assert(PerCPU_contains(i, percpu_shared) == 0);
+    }
+
+    PerCPUQueues_free(percpu_shared);
+    ++tests_passed;
+}
+
+/*
+    Sharded queue tests
+*/
+
+static void shardedKeepsGlobalFIFO(void) {
+    ShardedQueue *shardedqueue = new_ShardedQueue();
+    ThreadQueue *queue = (ThreadQueue*) shardedqueue;
+
+    for (int i = 0; i < 100; ++i) {
+        assert(queue -> enqueue(threads[i], queue).result == 1);
+    }
+
+    // consecutive IDs are spread over several shards
+    int used_shards = 0;
+    for (int i = 0; i < SHARDED_QUEUE_SHARDS; ++i) {
+        used_shards += (shardedqueue -> shards[i].queue -> _size > 0);
+    }
+    assert(used_shards > 1);
+
+    assert(queue -> removeByID(50, queue) == threads[50]);
+    assert(queue -> contains(50, queue) == 0);
+    assert(queue -> getByID(51, queue) == threads[51]);
+    assert(queue -> size(queue) == 99);
+
+    for (int i = 0; i < 100; ++i) {
+        if (i != 50) {
+            assert(queue -> dequeue(queue) == threads[i]);
+        }
+    }
+    assert(queue -> dequeue(queue) == NULL);
+    assert(queue -> isEmpty(queue));
+
+    queue -> freeQueue(queue);
+    ++tests_passed;
+}
+
+static void shardedIteratorMergesShards(void) {
+    ShardedQueue *shardedqueue = new_ShardedQueue();
+    ThreadQueue *queue = (ThreadQueue*) shardedqueue;
+
+    for (int i = 40; i >= 0; --i) {
+        queue -> enqueue(threads[i], queue);
+    }
+
+    Iterator *iterator = queue -> iterator(queue);
+    for (int i = 40; i >= 0; --i) {
+        assert(iterator -> hasNext(iterator));
+        assert(iterator -> next(iterator) == threads[i]);
+    }
+    assert(iterator -> hasNext(iterator) == 0);
+    free(iterator);
+
+    queue -> freeQueue(queue);
+    ++tests_passed;
+}
+
+#define SHARDED_TEST_WORKERS 4
+#define SHARDED_TEST_THREADS 4000
+
+static ShardedQueue *sharded_shared;
+static Thread sharded_threads[SHARDED_TEST_THREADS];
+static _Atomic int sharded_seen[SHARDED_TEST_THREADS];
+static _Atomic int sharded_done;
+
+/*
+    - Each worker enqueues its own quarter of the Threads while dequeuing anyone's
+*/
+static void *shardedWorker(void *arg) {
+    const int worker = (int) (long) arg;
+    ThreadQueue *queue = (ThreadQueue*) sharded_shared;
+    const int per_worker = SHARDED_TEST_THREADS / SHARDED_TEST_WORKERS;
+
+    for (int i = worker * per_worker; i < (worker + 1) * per_worker; ++i) {
+        assert(queue -> enqueue(&sharded_threads[i], queue).result == 1);
+        queue -> contains(i, queue);
+
+        Thread *t = queue -> dequeue(queue);
+        if (t != NULL) {
+            assert(atomic_fetch_add(&sharded_seen[t -> id], 1) == 0);
+            atomic_fetch_add(&sharded_done, 1);
+        }
+    }
+
+    while (atomic_load(&sharded_done) < SHARDED_TEST_THREADS) {
+        Thread *t = queue -> dequeue(queue);
+        if (t != NULL) {
+            assert(atomic_fetch_add(&sharded_seen[t -> id], 1) == 0);
+            atomic_fetch_add(&sharded_done, 1);
+        }
+    }
+    return NULL;
+}
+
+static void shardedConcurrentAccess(void) {
+    pthread_t workers[SHARDED_TEST_WORKERS];
+    sharded_shared = new_ShardedQueue();
+    atomic_store(&sharded_done, 0);
+
+    for (int i = 0; i < SHARDED_TEST_THREADS; ++i) {
+        sharded_threads[i].id = i;
+        atomic_store(&sharded_seen[i], 0);
+    }
+    for (int w = 0; w < SHARDED_TEST_WORKERS; ++w) {
+        pthread_create(&workers[w], NULL, shardedWorker, (void*) (long) w);
+    }
+    for (int w = 0; w < SHARDED_TEST_WORKERS; ++w) {
+        pthread_join(workers[w], NULL);
+    }
+
+    // every Thread was dequeued exactly once
+    for (int i = 0; i < SHARDED_TEST_THREADS; ++i) {
+        assert(atomic_load(&sharded_seen[i]) == 1);
+    }
+    assert(sharded_shared -> isEmpty((ThreadQueue*) sharded_shared));
+
+    sharded_shared -> freeQueue((ThreadQueue*) sharded_shared);
+    ++tests_passed;
+}
+
+/*
+    SwissQueue tests
+*/
+
+static void swissFingerprintsStored(void) {
+    SwissQueue *swissqueue = new_SwissQueue();
+    ThreadQueue *queue = (ThreadQueue*) swissqueue;
+
+    for (int i = 0; i < 10; ++i) {
+        queue -> enqueue(threads[i], queue);
+    }
+
+    for (int i = 0; i < 10; ++i) {
+        Entry *entry = NULL;
+        for (int j = 0; j < swissqueue -> capacity; ++j) {
+            if (swissqueue -> slots[j] != NULL && swissqueue -> slots[j] -> t == threads[i]) {
+                entry = swissqueue -> slots[j];
+            }
+        }
+        assert(entry != NULL);
+        assert(swissqueue -> control[entry -> table_index] == (FNV1AHash(i) & SWISS_FINGERPRINT_MASK));
+        assert(swissqueue -> keys[entry -> table_index] == i);
+        assert(queue -> getByID(i, queue) == threads[i]);
+    }
+    assert(queue -> contains(10, queue) == 0);
+
+    queue -> freeQueue(queue);
+    ++tests_passed;
+}
+
+static void swissTombstoneKeepsProbeChain(void) {
+    SwissQueue *swissqueue = new_SwissQueue();
+    ThreadQueue *queue = (ThreadQueue*) swissqueue;
+    swissqueue -> getHash = IDHash;             // IDs 0-127 all start probing at group 0
+
+    for (int i = 0; i < 17; ++i) {
+        queue -> enqueue(threads[i], queue);
+    }
+
+    // group 0 is full, so 16 overflowed into the next group
+    assert(swissqueue -> keys[16] == 16);
+    assert(queue -> removeByID(3, queue) == threads[3]);
+    assert(swissqueue -> control[3] == SWISS_DELETED);
+    assert(swissqueue -> tombstones == 1);
+    assert(queue -> getByID(16, queue) == threads[16]);
+
+    // with an empty slot in its group, removal can leave the slot empty
+    assert(queue -> removeByID(16, queue) == threads[16]);
+    assert(swissqueue -> control[16] == SWISS_EMPTY);
+
+    // tombstones are reused by later insertions
+    queue -> enqueue(threads[3], queue);
+    assert(swissqueue -> keys[3] == 3);
+    assert(swissqueue -> tombstones == 0);
+
+    queue -> freeQueue(queue);
+    ++tests_passed;
+}
+
+static void swissGrowthKeepsOrder(void) {
+    SwissQueue *swissqueue = new_SwissQueue();
+    ThreadQueue *queue = (ThreadQueue*) swissqueue;
+
+    for (int i = 0; i < 200; ++i) {
+        assert(queue -> enqueue(threads[i], queue).result == 1);
+    }
+    assert(swissqueue -> capacity == INITIAL_CAPACITY * 2);
+
+    for (int i = 0; i < 200; ++i) {
+        assert(queue -> contains(i, queue) == 1);
+    }
+    for (int i = 0; i < 200; ++i) {
+        assert(queue -> dequeue(queue) == threads[i]);
+    }
+    assert(queue -> isEmpty(queue) == 1);
+
+    queue -> freeQueue(queue);
+    ++tests_passed;
+}
+
+/*
+    IndexQueue tests
+*/
+
+static void indexEntryIsCompact(void) {
+    assert(sizeof(IndexEntry) == 8);
+
+    IndexQueue *indexqueue = new_IndexQueue();
+    ThreadQueue *queue = (ThreadQueue*) indexqueue;
+
+    // a single entry links to itself
+    queue -> enqueue(threads[3], queue);
+    assert(indexqueue -> entries[indexqueue -> head].prev == indexqueue -> head);
+    assert(indexqueue -> entries[indexqueue -> head].next == indexqueue -> head);
+    assert(queue -> dequeue(queue) == threads[3]);
+    assert(queue -> dequeue(queue) == NULL);
+
+    queue -> freeQueue(queue);
+    ++tests_passed;
+}
+
+static void indexGrowthKeepsOrder(void) {
+    IndexQueue *indexqueue = new_IndexQueue();
+    ThreadQueue *queue = (ThreadQueue*) indexqueue;
+
+    // outgrows both the initial entry array and the initial table
+    for (int i = 0; i < 200; ++i) {
+        assert(queue -> enqueue(threads[i], queue).result == 1);
+    }
+    assert(indexqueue -> entry_capacity == INDEX_INITIAL_ENTRIES * 4);
+    assert(indexqueue -> capacity == INITIAL_CAPACITY * 4);
+
+    for (int i = 0; i < 200; ++i) {
+        assert(queue -> getByID(i, queue) == threads[i]);
+    }
+
+    Iterator *iterator = queue -> iterator(queue);
+    for (int i = 0; i < 200; ++i) {
+        assert(iterator -> hasNext(iterator));
+        assert(iterator -> next(iterator) == threads[i]);
+    }
+    assert(iterator -> hasNext(iterator) == 0);
+    free(iterator);
+
+    for (int i = 0; i < 200; ++i) {
+        assert(queue -> dequeue(queue) == threads[i]);
+    }
+    assert(queue -> isEmpty(queue) == 1);
+
+    queue -> freeQueue(queue);
+    ++tests_passed;
+}
+
+static void indexRemoveByIDReusesEntries(void) {
+    IndexQueue *indexqueue = new_IndexQueue();
+    ThreadQueue *queue = (ThreadQueue*) indexqueue;
+
+    for (int i = 0; i < 10; ++i) {
+        queue -> enqueue(threads[i], queue);
+    }
+
+    assert(queue -> removeByID(0, queue) == threads[0]);    // head
+    assert(queue -> removeByID(5, queue) == threads[5]);    // intermediate
+    assert(queue -> removeByID(9, queue) == threads[9]);    // tail
+    assert(queue -> removeByID(9, queue) == NULL);
+    assert(queue -> contains(5, queue) == 0);
+    assert(indexqueue -> free_count == 3);
+
+    // released entries are handed out again before fresh ones
+    queue -> enqueue(threads[20], queue);
+    assert(indexqueue -> free_count == 2);
+    assert(indexqueue -> entries_used == 10);
+
+    const int expected[8] = {1, 2, 3, 4, 6, 7, 8, 20};
+    for (int i = 0; i < 8; ++i) {
+        assert(queue -> dequeue(queue) -> id == expected[i]);
+    }
+
+    queue -> freeQueue(queue);
+    ++tests_passed;
+}
+
+void runAllTests(void) {
+    // Setup global test variables
+    initialiseBasicThreads();
+    initialiseOverlappingThreads();
+
+    // Construction Test
+    runTest(constructionTest);
+
+    // Enqueue tests
+    runTest(sizeModified);
+    runTest(queuePointersUpdatedFirstInsertion);
+    runTest(tableUpdatedFirstInsertion);
+    runTest(addressUnmodified);
+    runTest(enqueueSuccessfulReturnValue);
+    runTest(queuePointersUpdatedSecondInsertion);
+    runLayoutTest(insert3);
+    runLayoutTest(robinHoodProbing);
+
+    
+    // Size tests
+    runTest(sizeEmpty);
+    runTest(sizeNonEmpty);
+    runTest(sizeMatchesPrivateField);
+
+    // Dequeue tests
+    runTest(dequeueSizesChanged);
+    runTest(dequeueEmptyFails);
+    runTest(dequeueCorrectElement);
+    runTest(dequeuePointersMended);
+    runLayoutTest(dequeueTableMended);
+    runLayoutTest(dequeueTableRepairTest);
+    runTest(dequeueLoneElementQPointersAmended);
+    runLayoutTest(dequeueTableIndicesUpdated);
+
+    // removeByID tests
+    runTest(removeByIDCorrectElement);
+    runTest(removeByIDSizeChanged);
+    runTest(removeByIDLoadFactorChanged);
+    runTest(removeByIDNotFound);
+    runLayoutTest(removeByIDIntermediatePointersMended);
+    runTest(removeByIDIntermediateTableAmended);
+    runLayoutTest(removeByIDHeadPointersAmended);
+    runLayoutTest(removeByIDHeadTableAmended);
+    runLayoutTest(removeByIDTailPointersAmended);
+    runLayoutTest(removeByIDTailTableAmended);
+    runLayoutTest(removeByIDTableRepairTest);
+    runLayoutTest(removeByIDTableRepairWrapAround);
+    runTest(removeByIDLoneElement);
+    runLayoutTest(removeByIDDuplicateIDs);
+    runLayoutTest(removeByIDTableIndicesUpdated1);
+    runLayoutTest(removeByIDTableIndicesUpdated2);
+
+    // GetByID tests
+    runTest(getByIDFalseReturnsNull);
+    runTest(getByIDReturnsCorrect);
+    runTest(getByIDNoModifications);
+    runTest(getByIDTwiceSameElementFound);
+    runLayoutTest(getByIDDuplicateElemsSameFound);
+    runLayoutTest(removeByIDCorrectLocationsAndPointers);
+
+    // Contains tests
+    runTest(containsTrue);
+    runTest(containsFalse);
+    runTest(containsFalseAfterDequeue);
+    runTest(containsFalseAfterRemoveByID);
+    runLayoutTest(containsContiguousBlockTest);
+
+    // Rehashing tests
+    runTest(noRehashBeforeThreshold);
+    runTest(addressUnmodifiedAfterRehash);
+    runTest(newTableQPointersCorrect);
+    runLayoutTest(correctRehashLocations);
+    runTest(rehashTableFieldsUpdated);
+    runTest(rehashFullChainMaintained);
+
+    // isEmpty tests
+    runTest(isEmptyTrue);
+    runTest(isEmptyFalse);
+    runTest(isEmptyFollowingDequeues);
+    runTest(isEmptyFollowingRemoveByIDs);
+    runTest(isEmptyPointersAgreePositive);
+    runTest(isEmptyPointersAgreeNegative);
+    
+    // Table repair tests
+    runLayoutTest(tableRepairNoMoveTest1);
+    runLayoutTest(tableRepairNoMoveTest2);
+    runLayoutTest(tableRepairNoMoveTest3);
+
+    // Iterator tests
+    runTest(constructIteratorTest);
+    runTest(iteratorHasNextTrue);
+    runTest(iteratorHasNextEmptyFalse);
+    runTest(iteratorHasNextDoesNotModify);
+    runTest(iteratorCorrectNext);
+    runTest(iteratorExampleUsage);
+    runTest(cursorExampleUsage);
+    runTest(forEachVisitsFIFO);
+    runTest(forEachEntryVisitsFIFO);
+
+    // Entry pool tests
+    runTest(poolInitialised);
+    runTest(poolRecyclesEntries);
+    runTest(poolSurvivesRehash);
+
+    // Intrusive HashQueue tests
+    runTest(intrusiveFIFOThroughThreadList);
+    runTest(intrusiveRemoveByIDTableRepair);
+    runTest(intrusiveRehashAddressStable);
+    runTest(intrusiveIterator);
+
+    // DirectQueue tests
+    runTest(directIndexedByID);
+    runTest(directDuplicateRejected);
+    runTest(directRemoveByIDKeepsOrder);
+
+    // Incremental rehash tests
+    runTest(incrementalRehashDefersMigration);
+    runTest(incrementalRehashCompletes);
+    runTest(incrementalRehashRemoveFromOldTable);
+    runTest(resizeFinishesLongMigration);
+
+    // Shrink tests
+    runTest(shrinkBelowLowWaterMark);
+    runTest(shrinkStopsAtInitialCapacity);
+    runTest(shrinkDisabled);
+
+    // Sizing tests
+    runTest(withSizesTableForHint);
+    runTest(withSmallHintAndMaxLoad);
+    runTest(reserveGrowsOnceAndHolds);
+    runTest(limitsFollowCapacity);
+    runTest(limitsRoundLikeDivision);
+    runTest(tinyMaxLoadStopsAtMaxCapacity);
+
+    // Slot array tests
+    runLayoutTest(slotsMirrorTable);
+    runTest(slotsMirrorTableAfterRehash);
+
+    // Wakeup inbox tests
+    runTest(inboxDrainedOnDequeue);
+    runTest(inboxConcurrentProducers);
+
+    // Batch enqueue tests
+    runTest(enqueueBatchGrowsOnce);
+    runTest(enqueueBatchAppendsToTail);
+    runTest(enqueueBatchAllBackends);
+
+    // Batch dequeue tests
+    runLayoutTest(dequeueNRepairsCluster);
+    runTest(dequeueNStopsWhenEmpty);
+    runTest(dequeueNAllBackends);
+
+    // Bulk removal tests
+    runLayoutTest(removeByIDsRepairsClusters);
+    runTest(removeByIDsManyIDs);
+
+    // Filtered removal tests
+    runTest(removeIfEvictsMatching);
+    runTest(removeIfManyThreads);
+    runTest(forEachSafeRemoval);
+
+    // Hash function tests
+    runTest(fnv1aHashesBothOctets);
+    runTest(hashFamilyUsableAsGetHash);
+
+    // Statistics tests
+    runTest(statsRecordProbesAndRepairs);
+    runTest(statsCountRehashes);
+
+    // PriorityQueue tests
+    runTest(priorityDequeueHighestFirst);
+    runTest(priorityRemoveAndReprioritise);
+    runTest(priorityIteratorFollowsDequeueOrder);
+
+    // Inline API tests
+    runTest(inlineLookupMatchesVtable);
+    runTest(inlineKeepsFIFO);
+    runTest(inlineNewUsesSelectedHash);
+
+    // Optimistic reader tests
+    runTest(readLookupMatchesGetByID);
+    runTest(retiredTableWaitsForReaders);
+    runTest(readersDuringRehash);
+    runTest(readersDuringChurn);
+
+    // Per-CPU queue tests
+    runTest(percpuRemoveFindsRemoteThread);
+    runTest(percpuStealTakesTailBatch);
+    runTest(percpuConcurrentStealing);
+
+    // Sharded queue tests
+    runTest(shardedKeepsGlobalFIFO);
+    runTest(shardedIteratorMergesShards);
+    runTest(shardedConcurrentAccess);
+
+    // SwissQueue tests
+    runTest(swissFingerprintsStored);
+    runTest(swissTombstoneKeepsProbeChain);
+    runTest(swissGrowthKeepsOrder);
+
+    // IndexQueue tests
+    runTest(indexEntryIsCompact);
+    runTest(indexGrowthKeepsOrder);
+    runTest(indexRemoveByIDReusesEntries);
+    
+    freeThreads();
+    
+    printf("Passed %u/%u tests.\n", tests_passed, test_count - tests_skipped);
+    if (tests_skipped > 0) {
+        printf("Skipped %u table layout tests, HQ_STATIC_HASH ignores getHash.\n", tests_skipped);
+    }
 }
 
 